@@ -0,0 +1,39 @@
+#include "BenchPlugin.hpp"
+#include "PluginAllocator.hpp"
+
+namespace {
+
+    struct Widget : BenchEntity {
+        Widget(int id)
+            : _id(id)
+        {
+        }
+
+        int id() const override
+        {
+            return _id;
+        }
+
+        int _id;
+    };
+
+} // namespace
+
+extern "C" {
+
+    BenchEntity *create(int id)
+    {
+        return new Widget(id);
+    }
+
+    void destroy(BenchEntity *entity)
+    {
+        delete entity;
+    }
+
+    BenchEntity *createPooled(cpputils::PluginAllocator *allocator, int id)
+    {
+        return cpputils::pluginNew<Widget>(allocator, id);
+    }
+
+}
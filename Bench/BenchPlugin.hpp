@@ -0,0 +1,7 @@
+#pragma once
+
+// Interface of the plugin loaded by the DLLoader benchmarks
+struct BenchEntity {
+    virtual ~BenchEntity() = default;
+    virtual int id() const = 0;
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include "CpuFeatures.hpp"
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+namespace cpputils::bench {
+
+    // Keeps the compiler from discarding a value or the stores before it
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    // CPU cycles of the calling thread through perf_event. available() is
+    // false when the kernel or the machine does not expose the counter.
+    class CycleCounter {
+    public:
+        CycleCounter()
+        {
+#ifdef __linux__
+            struct perf_event_attr attr = {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            _fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+        CycleCounter(const CycleCounter &) = delete;
+        CycleCounter &operator=(const CycleCounter &) = delete;
+        ~CycleCounter()
+        {
+#ifdef __linux__
+            if (_fd >= 0)
+                ::close(_fd);
+#endif
+        }
+
+        bool available() const
+        {
+            return _fd >= 0;
+        }
+
+        void start()
+        {
+#ifdef __linux__
+            if (_fd < 0)
+                return;
+            ::ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        u_int64_t stop()
+        {
+            u_int64_t cycles = 0;
+#ifdef __linux__
+            if (_fd < 0)
+                return 0;
+            ::ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (::read(_fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+                cycles = 0;
+#endif
+            return cycles;
+        }
+
+    private:
+        int _fd = -1;
+    };
+
+    // Pins the dispatched Math and Color kernels to one code path while in
+    // scope. Benchmarks return early when the CPU does not support it.
+    class SimdScope {
+    public:
+        SimdScope(SimdLevel level)
+            : _supported(level <= cpuSimdLevel())
+        {
+            if (_supported)
+                setSimdLevel(level);
+        }
+        SimdScope(const SimdScope &) = delete;
+        SimdScope &operator=(const SimdScope &) = delete;
+        ~SimdScope()
+        {
+            resetSimdLevel();
+        }
+
+        bool supported() const
+        {
+            return _supported;
+        }
+
+    private:
+        bool _supported;
+    };
+
+    struct Options {
+        std::string filter;
+        double minTimeMs = 20;
+        int repetitions = 5;
+    };
+
+    struct Result {
+        std::string name;
+        std::string type;
+        size_t size = 0;
+        u_int64_t iterations = 0;
+        double nsPerElement = 0;
+        // Negative when no hardware counter is available
+        double cyclesPerElement = -1;
+        double bytesPerSecond = 0;
+    };
+
+    // Handed to each benchmark. The benchmark prepares its data for size()
+    // and calls run() once with the body to measure.
+    class State {
+    public:
+        State(size_t size, const Options &options, CycleCounter &counter)
+            : _size(size), _options(options), _counter(counter)
+        {
+        }
+
+        size_t size() const
+        {
+            return _size;
+        }
+
+        // Times body, which processes elements elements (and bytes bytes,
+        // if it produces or consumes a byte stream) per call. The iteration
+        // count grows until one repetition lasts minTimeMs; the median of
+        // the repetitions is kept.
+        template <typename F>
+        void run(u_int64_t elements, F &&body, u_int64_t bytes = 0)
+        {
+            using Clock = std::chrono::steady_clock;
+            u_int64_t iterations = 1;
+            double targetNs = _options.minTimeMs * 1e6;
+            for (;;) {
+                auto start = Clock::now();
+                for (u_int64_t i = 0; i < iterations; i++)
+                    body();
+                double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                if (elapsed >= targetNs)
+                    break;
+                double factor = elapsed > 0 ? targetNs / elapsed * 1.2 : 10;
+                iterations = static_cast<u_int64_t>(iterations * std::clamp(factor, 2.0, 10.0));
+            }
+
+            std::vector<double> ns;
+            std::vector<double> cycles;
+            for (int rep = 0; rep < std::max(_options.repetitions, 1); rep++) {
+                _counter.start();
+                auto start = Clock::now();
+                for (u_int64_t i = 0; i < iterations; i++)
+                    body();
+                auto end = Clock::now();
+                u_int64_t count = _counter.stop();
+                ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+                cycles.push_back(static_cast<double>(count));
+            }
+
+            double total = static_cast<double>(iterations) * std::max<u_int64_t>(elements, 1);
+            _result.iterations = iterations;
+            _result.nsPerElement = median(ns) / total;
+            if (_counter.available())
+                _result.cyclesPerElement = median(cycles) / total;
+            if (bytes)
+                _result.bytesPerSecond = static_cast<double>(iterations) * bytes / (median(ns) * 1e-9);
+            _ran = true;
+        }
+
+        bool ran() const
+        {
+            return _ran;
+        }
+
+        const Result &result() const
+        {
+            return _result;
+        }
+
+    private:
+        static double median(std::vector<double> values)
+        {
+            std::sort(values.begin(), values.end());
+            size_t mid = values.size() / 2;
+            return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+        }
+
+        size_t _size;
+        const Options &_options;
+        CycleCounter &_counter;
+        Result _result;
+        bool _ran = false;
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::string type;
+        std::vector<size_t> sizes;
+        std::function<void(State &)> function;
+    };
+
+    inline std::vector<Benchmark> &registry()
+    {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    // Each benchmark source registers a static table of these
+    struct Registrar {
+        Registrar(std::string name, std::string type, std::vector<size_t> sizes, std::function<void(State &)> function)
+        {
+            registry().push_back(Benchmark{std::move(name), std::move(type), std::move(sizes), std::move(function)});
+        }
+    };
+
+    inline void writeJson(std::ostream &os, const std::vector<Result> &results, const Options &options, bool hardwareCycles)
+    {
+        os << "{\n  \"context\": {\"hardwareCycles\": " << (hardwareCycles ? "true" : "false")
+            << ", \"minTimeMs\": " << options.minTimeMs << ", \"repetitions\": " << options.repetitions << "},\n"
+            << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &result = results[i];
+            os << (i ? "," : "") << "\n    {\"name\": \"" << result.name << "\", \"type\": \"" << result.type
+                << "\", \"size\": " << result.size << ", \"iterations\": " << result.iterations
+                << ", \"nsPerElement\": " << result.nsPerElement << ", \"cyclesPerElement\": ";
+            if (result.cyclesPerElement >= 0)
+                os << result.cyclesPerElement;
+            else
+                os << "null";
+            os << ", \"bytesPerSecond\": ";
+            if (result.bytesPerSecond > 0)
+                os << result.bytesPerSecond;
+            else
+                os << "null";
+            os << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+} // namespace cpputils::bench
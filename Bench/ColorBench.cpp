@@ -0,0 +1,229 @@
+#include <random>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "Color.hpp"
+#include "Encoder.hpp"
+#include "Gradient.hpp"
+#include "PackedColor.hpp"
+#include "Palette.hpp"
+#include "PixelKernels.hpp"
+
+using namespace cpputils;
+using namespace cpputils::bench;
+
+namespace {
+
+    const std::vector<size_t> pixelCounts = {1024, 65536, 1048576};
+
+    template <typename T>
+    std::vector<Color<T>> randomColors(size_t count, u_int32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<T> dist(0, 1);
+        std::vector<Color<T>> colors;
+        colors.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            colors.emplace_back(dist(rng), dist(rng), dist(rng), dist(rng));
+        return colors;
+    }
+
+    template <typename Packed>
+    std::vector<Packed> randomPacked(size_t count, u_int32_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        std::vector<Packed> colors;
+        colors.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            colors.push_back(Packed(static_cast<decltype(Packed::value)>(rng())));
+        return colors;
+    }
+
+    template <typename T>
+    void blend(State &state)
+    {
+        std::vector<Color<T>> fg = randomColors<T>(state.size(), 1);
+        std::vector<Color<T>> bg = randomColors<T>(state.size(), 2);
+        std::vector<Color<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < fg.size(); i++) {
+                out[i] = fg[i];
+                out[i].blend(bg[i]);
+            }
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename T>
+    void toInt(State &state)
+    {
+        std::vector<Color<T>> colors = randomColors<T>(state.size(), 3);
+        std::vector<u_int32_t> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < colors.size(); i++)
+                out[i] = colors[i].toInt();
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename Packed>
+    void packedOver(State &state)
+    {
+        std::vector<Packed> src = randomPacked<Packed>(state.size(), 4);
+        std::vector<Packed> dst = randomPacked<Packed>(state.size(), 5);
+        std::vector<Packed> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < src.size(); i++)
+                out[i] = src[i].over(dst[i]);
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename Packed>
+    void packedLerp(State &state)
+    {
+        std::vector<Packed> a = randomPacked<Packed>(state.size(), 6);
+        std::vector<Packed> b = randomPacked<Packed>(state.size(), 7);
+        std::vector<Packed> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i].lerp(b[i], static_cast<decltype(a[i].r())>(i));
+            doNotOptimize(out.data());
+        });
+    }
+
+    // size is the palette size; 16384 pixels are mapped per call
+    template <typename T>
+    void paletteNearest(State &state)
+    {
+        std::vector<Color<T>> colors = randomColors<T>(state.size() + 16384, 8);
+        std::vector<Color3<T>> entries;
+        std::vector<Color3<T>> pixels;
+        for (size_t i = 0; i < colors.size(); i++)
+            (i < state.size() ? entries : pixels).push_back(colors[i].color);
+        Palette<T> palette(entries);
+        std::vector<u_int32_t> indices(pixels.size());
+        state.run(pixels.size(), [&]() {
+            palette.map(pixels.data(), pixels.size(), indices.data());
+            doNotOptimize(indices.data());
+        });
+    }
+
+    template <typename T>
+    void gradientMap(State &state)
+    {
+        Gradient<T> gradient = Gradient<T>::viridis();
+        std::mt19937 rng(9);
+        std::uniform_real_distribution<T> dist(0, 1);
+        std::vector<T> values(state.size());
+        for (T &value : values)
+            value = dist(rng);
+        std::vector<Color32> out(state.size());
+        state.run(state.size(), [&]() {
+            gradient.map(values.data(), values.size(), out.data());
+            doNotOptimize(out.data());
+        });
+    }
+
+    // Encodes a 256 pixel wide image of size pixels with smooth content
+    // and some noise, so QOI exercises its run, diff and literal paths
+    template <typename Encoder, typename T>
+    void encode(State &state)
+    {
+        constexpr size_t width = 256;
+        size_t height = state.size() / width;
+        std::mt19937 rng(10);
+        std::vector<Color<T>> image(width * height);
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                T noise = static_cast<T>(rng() % 8) / 255;
+                image[y * width + x] = Color<T>(T(x) / width, T(y) / height, (x / 16 % 2) ? noise : T(0.5), 1);
+            }
+        }
+        std::vector<u_int8_t> buffer(Encoder::maxSize(width, height, 4));
+        size_t bytes = 0;
+        auto body = [&]() {
+            Encoder encoder(buffer.data(), buffer.size());
+            encoder.begin(width, height, 4);
+            for (size_t y = 0; y < height; y++)
+                encoder.writeRow(image.data() + y * width);
+            bytes = encoder.finish();
+            doNotOptimize(buffer.data());
+        };
+        body();
+        state.run(width * height, body, bytes);
+    }
+
+    template <SimdLevel Level>
+    void blendPixelsAt(State &state)
+    {
+        SimdScope scope(Level);
+        if (!scope.supported())
+            return;
+        std::vector<Color4f> fg = randomColors<float>(state.size(), 11);
+        std::vector<Color4f> bg = randomColors<float>(state.size(), 12);
+        std::vector<Color4f> out(state.size());
+        state.run(state.size(), [&]() {
+            blendPixels(fg.data(), bg.data(), out.data(), out.size());
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <SimdLevel Level>
+    void packPixelsAt(State &state)
+    {
+        SimdScope scope(Level);
+        if (!scope.supported())
+            return;
+        std::vector<Color4f> pixels = randomColors<float>(state.size(), 13);
+        std::vector<Color32> out(state.size());
+        state.run(state.size(), [&]() {
+            packPixels(pixels.data(), out.data(), out.size());
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <SimdLevel Level>
+    void unpackPixelsAt(State &state)
+    {
+        SimdScope scope(Level);
+        if (!scope.supported())
+            return;
+        std::vector<Color32> pixels = randomPacked<Color32>(state.size(), 14);
+        std::vector<Color4f> out(state.size());
+        state.run(state.size(), [&]() {
+            unpackPixels(pixels.data(), out.data(), out.size());
+            doNotOptimize(out.data());
+        });
+    }
+
+    const Registrar colorBenchmarks[] = {
+        {"Color::blend", "float", pixelCounts, blend<float>},
+        {"Color::blend", "double", pixelCounts, blend<double>},
+        {"Color::toInt", "float", pixelCounts, toInt<float>},
+        {"Color::toInt", "double", pixelCounts, toInt<double>},
+        {"PackedColor::over", "Color32", pixelCounts, packedOver<Color32>},
+        {"PackedColor::over", "Color64", pixelCounts, packedOver<Color64>},
+        {"PackedColor::lerp", "Color32", pixelCounts, packedLerp<Color32>},
+        {"PackedColor::lerp", "Color64", pixelCounts, packedLerp<Color64>},
+        {"Palette::map", "float", {16, 256, 4096}, paletteNearest<float>},
+        {"Palette::map", "double", {16, 256, 4096}, paletteNearest<double>},
+        {"Gradient::map", "float", pixelCounts, gradientMap<float>},
+        {"Gradient::map", "double", pixelCounts, gradientMap<double>},
+        {"PnmEncoder", "float", {65536, 1048576}, encode<PnmEncoder, float>},
+        {"QoiEncoder", "float", {65536, 1048576}, encode<QoiEncoder, float>},
+        {"blendPixels", "scalar", pixelCounts, blendPixelsAt<SimdLevel::Scalar>},
+        {"blendPixels", "sse2", pixelCounts, blendPixelsAt<SimdLevel::SSE2>},
+        {"blendPixels", "avx2", pixelCounts, blendPixelsAt<SimdLevel::AVX2>},
+        {"blendPixels", "avx512", pixelCounts, blendPixelsAt<SimdLevel::AVX512>},
+        {"packPixels", "scalar", pixelCounts, packPixelsAt<SimdLevel::Scalar>},
+        {"packPixels", "sse2", pixelCounts, packPixelsAt<SimdLevel::SSE2>},
+        {"packPixels", "avx2", pixelCounts, packPixelsAt<SimdLevel::AVX2>},
+        {"packPixels", "avx512", pixelCounts, packPixelsAt<SimdLevel::AVX512>},
+        {"unpackPixels", "scalar", pixelCounts, unpackPixelsAt<SimdLevel::Scalar>},
+        {"unpackPixels", "sse2", pixelCounts, unpackPixelsAt<SimdLevel::SSE2>},
+        {"unpackPixels", "avx2", pixelCounts, unpackPixelsAt<SimdLevel::AVX2>},
+        {"unpackPixels", "avx512", pixelCounts, unpackPixelsAt<SimdLevel::AVX512>},
+    };
+
+} // namespace
@@ -0,0 +1,83 @@
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "BenchPlugin.hpp"
+#include "DLLoader.hpp"
+#include "PluginAllocator.hpp"
+
+using namespace cpputils;
+using namespace cpputils::bench;
+
+namespace {
+
+    const char *pluginDir = CPPUTILS_BENCH_PLUGIN_DIR;
+    const char *pluginName = "cpputils_bench_plugin";
+    const std::vector<size_t> instanceCounts = {1, 64, 1024};
+
+    template <BindPolicy Policy>
+    void load(State &state)
+    {
+        DLLoader<BenchEntity> loader;
+        state.run(1, [&]() {
+            loader.load(pluginDir, pluginName, Policy);
+        });
+    }
+
+    // Cached lookup of one symbol, size times per call
+    void getSymbol(State &state)
+    {
+        DLLoader<BenchEntity> loader(pluginDir, pluginName);
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++)
+                doNotOptimize(loader.getSymbol<BenchEntity *(int)>("create"));
+        });
+    }
+
+    // size instances created through create() and released with destroy()
+    void getInstance(State &state)
+    {
+        DLLoader<BenchEntity> loader(pluginDir, pluginName, {"create", "destroy"});
+        auto destroy = loader.getSymbol<void(BenchEntity *)>("destroy");
+        std::vector<BenchEntity *> instances(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < instances.size(); i++)
+                instances[i] = loader.getInstance("create", static_cast<int>(i));
+            for (BenchEntity *instance : instances)
+                destroy(instance);
+        });
+    }
+
+    void getPooledInstance(State &state, PluginAllocator &allocator)
+    {
+        DLLoader<BenchEntity> loader(pluginDir, pluginName, {"createPooled"});
+        std::vector<PluginPtr<BenchEntity>> instances(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < instances.size(); i++)
+                instances[i] = loader.getPooledInstance("createPooled", allocator, static_cast<int>(i));
+            for (auto &instance : instances)
+                instance.reset();
+        });
+    }
+
+    void heapInstances(State &state)
+    {
+        HeapPluginAllocator allocator;
+        getPooledInstance(state, allocator);
+    }
+
+    void poolInstances(State &state)
+    {
+        PoolPluginAllocator allocator(64, state.size());
+        getPooledInstance(state, allocator);
+    }
+
+    const Registrar dlloaderBenchmarks[] = {
+        {"DLLoader::load", "Lazy", {1}, load<BindPolicy::Lazy>},
+        {"DLLoader::load", "Now", {1}, load<BindPolicy::Now>},
+        {"DLLoader::getSymbol", "cached", {1, 1024}, getSymbol},
+        {"DLLoader::getInstance", "new", instanceCounts, getInstance},
+        {"DLLoader::getPooledInstance", "HeapPluginAllocator", instanceCounts, heapInstances},
+        {"DLLoader::getPooledInstance", "PoolPluginAllocator", instanceCounts, poolInstances},
+    };
+
+} // namespace
@@ -0,0 +1,156 @@
+#include <random>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "Math.hpp"
+#include "VectorKernels.hpp"
+
+using namespace cpputils;
+using namespace cpputils::Math;
+using namespace cpputils::bench;
+
+namespace {
+
+    const std::vector<size_t> vectorCounts = {1024, 65536, 1048576};
+
+    template <typename T>
+    std::vector<Vector3<T>> randomVectors(size_t count, u_int32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<T> dist(-1, 1);
+        std::vector<Vector3<T>> vectors;
+        vectors.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            vectors.emplace_back(dist(rng), dist(rng), dist(rng));
+        return vectors;
+    }
+
+    template <typename T>
+    void add(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 1);
+        std::vector<Vector3<T>> b = randomVectors<T>(state.size(), 2);
+        std::vector<Vector3<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i] + b[i];
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename T>
+    void scale(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 3);
+        std::vector<Vector3<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i] * T(1.5);
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename T>
+    void dotProduct(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 4);
+        std::vector<Vector3<T>> b = randomVectors<T>(state.size(), 5);
+        state.run(state.size(), [&]() {
+            T sum = 0;
+            for (size_t i = 0; i < a.size(); i++)
+                sum += a[i].dot(b[i]);
+            doNotOptimize(sum);
+        });
+    }
+
+    template <typename T>
+    void crossProduct(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 6);
+        std::vector<Vector3<T>> b = randomVectors<T>(state.size(), 7);
+        std::vector<Vector3<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i].cross(b[i]);
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename T>
+    void unit(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 8);
+        std::vector<Vector3<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i].unit();
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <typename T>
+    void rotate(State &state)
+    {
+        std::vector<Vector3<T>> a = randomVectors<T>(state.size(), 9);
+        std::vector<Vector3<T>> out(state.size());
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < a.size(); i++)
+                out[i] = a[i].rotate(T(10), T(20), T(30));
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <SimdLevel Level>
+    void addVectorsAt(State &state)
+    {
+        SimdScope scope(Level);
+        if (!scope.supported())
+            return;
+        std::vector<Vector3f> a = randomVectors<float>(state.size(), 10);
+        std::vector<Vector3f> b = randomVectors<float>(state.size(), 11);
+        std::vector<Vector3f> out(state.size());
+        state.run(state.size(), [&]() {
+            addVectors(a.data(), b.data(), out.data(), out.size());
+            doNotOptimize(out.data());
+        });
+    }
+
+    template <SimdLevel Level>
+    void dotVectorsAt(State &state)
+    {
+        SimdScope scope(Level);
+        if (!scope.supported())
+            return;
+        std::vector<Vector3f> a = randomVectors<float>(state.size(), 12);
+        std::vector<Vector3f> b = randomVectors<float>(state.size(), 13);
+        std::vector<float> out(state.size());
+        state.run(state.size(), [&]() {
+            dotVectors(a.data(), b.data(), out.data(), out.size());
+            doNotOptimize(out.data());
+        });
+    }
+
+    const Registrar mathBenchmarks[] = {
+        {"Vector3::operator+", "float", vectorCounts, add<float>},
+        {"Vector3::operator+", "double", vectorCounts, add<double>},
+        {"Vector3::operator*", "float", vectorCounts, scale<float>},
+        {"Vector3::operator*", "double", vectorCounts, scale<double>},
+        {"Vector3::dot", "float", vectorCounts, dotProduct<float>},
+        {"Vector3::dot", "double", vectorCounts, dotProduct<double>},
+        {"Vector3::cross", "float", vectorCounts, crossProduct<float>},
+        {"Vector3::cross", "double", vectorCounts, crossProduct<double>},
+        {"Vector3::unit", "float", vectorCounts, unit<float>},
+        {"Vector3::unit", "double", vectorCounts, unit<double>},
+        {"Vector3::rotate", "float", vectorCounts, rotate<float>},
+        {"Vector3::rotate", "double", vectorCounts, rotate<double>},
+        {"addVectors", "scalar", vectorCounts, addVectorsAt<SimdLevel::Scalar>},
+        {"addVectors", "sse2", vectorCounts, addVectorsAt<SimdLevel::SSE2>},
+        {"addVectors", "avx2", vectorCounts, addVectorsAt<SimdLevel::AVX2>},
+        {"addVectors", "avx512", vectorCounts, addVectorsAt<SimdLevel::AVX512>},
+        {"dotVectors", "scalar", vectorCounts, dotVectorsAt<SimdLevel::Scalar>},
+        {"dotVectors", "sse2", vectorCounts, dotVectorsAt<SimdLevel::SSE2>},
+        {"dotVectors", "avx2", vectorCounts, dotVectorsAt<SimdLevel::AVX2>},
+        {"dotVectors", "avx512", vectorCounts, dotVectorsAt<SimdLevel::AVX512>},
+    };
+
+} // namespace
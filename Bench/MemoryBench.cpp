@@ -0,0 +1,152 @@
+#include <list>
+#include <random>
+#include <vector>
+#include <memory_resource>
+
+#include "Arena.hpp"
+#include "Benchmark.hpp"
+#include "Color.hpp"
+#include "Pool.hpp"
+#include "Signal.hpp"
+#include "ThreadCache.hpp"
+
+using namespace cpputils;
+using namespace cpputils::bench;
+
+namespace {
+
+    const std::vector<size_t> nodeCounts = {64, 1024, 16384};
+
+    // size is the node count; one list is built and torn down per call, the
+    // per element cost is one allocate/deallocate pair plus the list work
+    void listNewDelete(State &state)
+    {
+        state.run(state.size(), [&]() {
+            std::pmr::list<size_t> nodes(std::pmr::new_delete_resource());
+            for (size_t i = 0; i < state.size(); i++)
+                nodes.push_back(i);
+            doNotOptimize(nodes.back());
+        });
+    }
+
+    void listArena(State &state)
+    {
+        Arena arena;
+        state.run(state.size(), [&]() {
+            {
+                std::pmr::list<size_t> nodes(&arena);
+                for (size_t i = 0; i < state.size(); i++)
+                    nodes.push_back(i);
+                doNotOptimize(nodes.back());
+            }
+            arena.reset();
+        });
+    }
+
+    void listPool(State &state)
+    {
+        Pool pool(sizeof(std::pmr::list<size_t>::value_type) + 2 * sizeof(void *), alignof(std::max_align_t), 256);
+        state.run(state.size(), [&]() {
+            std::pmr::list<size_t> nodes(&pool);
+            for (size_t i = 0; i < state.size(); i++)
+                nodes.push_back(i);
+            doNotOptimize(nodes.back());
+        });
+    }
+
+    void listThreadCache(State &state)
+    {
+        state.run(state.size(), [&]() {
+            std::pmr::list<size_t> nodes(&ThreadCache::instance());
+            for (size_t i = 0; i < state.size(); i++)
+                nodes.push_back(i);
+            doNotOptimize(nodes.back());
+        });
+    }
+
+    std::vector<Color4f> randomColors(size_t count)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist(0, 1);
+        std::vector<Color4f> colors;
+        for (size_t i = 0; i < count; i++)
+            colors.emplace_back(dist(rng), dist(rng), dist(rng), dist(rng));
+        return colors;
+    }
+
+    void colorToString(State &state)
+    {
+        std::vector<Color4f> colors = randomColors(state.size());
+        state.run(state.size(), [&]() {
+            for (const Color4f &color : colors)
+                doNotOptimize(color.toString().size());
+        });
+    }
+
+    void colorToStringArena(State &state)
+    {
+        std::vector<Color4f> colors = randomColors(state.size());
+        Arena arena;
+        state.run(state.size(), [&]() {
+            for (const Color4f &color : colors)
+                doNotOptimize(color.toString(&arena).size());
+            arena.reset();
+        });
+    }
+
+    // size is the slot count; every slot captures more than InplaceFunction
+    // holds inline, so each connect allocates
+    template <typename Resource>
+    void signalConnect(State &state)
+    {
+        char padding[64] = {};
+        state.run(state.size(), [&]() {
+            Resource resource;
+            {
+                Signal<int> signal(resource.get());
+                for (size_t i = 0; i < state.size(); i++)
+                    signal.connect([padding](int value) { doNotOptimize(padding[0] + value); });
+                signal.emit(1);
+            }
+            resource.done();
+        });
+    }
+
+    struct HeapResource {
+        std::pmr::memory_resource *get()
+        {
+            return std::pmr::new_delete_resource();
+        }
+        void done()
+        {
+        }
+    };
+
+    struct ArenaResource {
+        std::pmr::memory_resource *get()
+        {
+            return &arena();
+        }
+        void done()
+        {
+            arena().reset();
+        }
+        static Arena &arena()
+        {
+            static Arena instance;
+            return instance;
+        }
+    };
+
+    const Registrar memoryBenchmarks[] = {
+        {"pmr::list::push_back", "new_delete", nodeCounts, listNewDelete},
+        {"pmr::list::push_back", "Arena", nodeCounts, listArena},
+        {"pmr::list::push_back", "Pool", nodeCounts, listPool},
+        {"pmr::list::push_back", "ThreadCache", nodeCounts, listThreadCache},
+        {"Color::toString", "std::string", {1024}, colorToString},
+        {"Color::toString", "Arena", {1024}, colorToStringArena},
+        {"Signal::connect", "new_delete", {16, 256}, signalConnect<HeapResource>},
+        {"Signal::connect", "Arena", {16, 256}, signalConnect<ArenaResource>},
+    };
+
+} // namespace
@@ -0,0 +1,219 @@
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include "Arena.hpp"
+#include "Pool.hpp"
+#include "ThreadCache.hpp"
+
+using namespace cpputils;
+
+// Runs the Memory resources from several threads and checks that no block
+// is handed out twice or overwritten: every allocation is filled with a
+// pattern derived from its owner and checked before it is freed. Threads
+// are restarted every round, so ThreadCache also sees threads exiting with
+// partly used caches and blocks freed by threads other than their owner.
+// Meant to be run under ThreadSanitizer or AddressSanitizer as well.
+
+namespace {
+
+    struct Failures {
+        std::atomic<u_int64_t> count{0};
+
+        void report(const char *what)
+        {
+            if (count.fetch_add(1) < 10)
+                std::fprintf(stderr, "FAIL: %s\n", what);
+        }
+    };
+
+    struct Block {
+        unsigned char *data;
+        size_t size;
+        unsigned char pattern;
+    };
+
+    void fill(const Block &block)
+    {
+        std::memset(block.data, block.pattern, block.size);
+    }
+
+    bool intact(const Block &block)
+    {
+        for (size_t i = 0; i < block.size; i++) {
+            if (block.data[i] != block.pattern)
+                return false;
+        }
+        return true;
+    }
+
+    // Nested mark/rewind must restore used() and leave earlier allocations alone
+    void arenaRound(std::mt19937 &rng, Failures &failures)
+    {
+        Arena arena(1024);
+        std::uniform_int_distribution<size_t> size(1, 700);
+        std::vector<Block> outer;
+        for (int i = 0; i < 64; i++) {
+            Block block{nullptr, size(rng), static_cast<unsigned char>(i)};
+            block.data = static_cast<unsigned char *>(arena.allocate(block.size, 8));
+            fill(block);
+            outer.push_back(block);
+        }
+        for (int depth = 0; depth < 8; depth++) {
+            Arena::Marker marker = arena.mark();
+            size_t used = arena.used();
+            {
+                ArenaScope scope(arena);
+                for (int i = 0; i < 32; i++) {
+                    size_t bytes = size(rng);
+                    void *ptr = arena.allocate(bytes, 16);
+                    if (reinterpret_cast<uintptr_t>(ptr) % 16 != 0)
+                        failures.report("Arena returned a misaligned block");
+                    std::memset(ptr, 0xEE, bytes);
+                }
+            }
+            if (arena.used() != used)
+                failures.report("ArenaScope did not restore used()");
+            std::memset(arena.allocate(size(rng), 8), 0xEE, 1);
+            arena.rewind(marker);
+            if (arena.used() != used)
+                failures.report("Arena rewind() did not restore used()");
+            // Leave the next level with more to rewind over
+            Block block{nullptr, size(rng), static_cast<unsigned char>(0x80 + depth)};
+            block.data = static_cast<unsigned char *>(arena.allocate(block.size, 8));
+            fill(block);
+            outer.push_back(block);
+        }
+        for (const Block &block : outer) {
+            if (!intact(block))
+                failures.report("Arena rewind overwrote an earlier allocation");
+        }
+        arena.reset();
+        if (arena.used() != 0)
+            failures.report("Arena reset() left bytes in use");
+    }
+
+    void poolRound(std::mt19937 &rng, Failures &failures)
+    {
+        struct Item {
+            u_int64_t value;
+            u_int64_t check;
+        };
+        ObjectPool<Item> pool(16);
+        std::vector<Item *> items;
+        std::uniform_int_distribution<int> coin(0, 2);
+        for (u_int64_t i = 0; i < 2000; i++) {
+            if (!items.empty() && coin(rng) == 0) {
+                Item *item = items.back();
+                items.pop_back();
+                if (item->check != ~item->value)
+                    failures.report("Pool block was overwritten");
+                pool.destroy(item);
+            } else {
+                items.push_back(pool.create(Item{i, ~i}));
+            }
+        }
+        if (pool.inUse() != items.size())
+            failures.report("Pool inUse() does not match live objects");
+        for (Item *item : items) {
+            if (item->check != ~item->value)
+                failures.report("Pool block was overwritten");
+            pool.destroy(item);
+        }
+        if (pool.inUse() != 0)
+            failures.report("Pool inUse() is not zero after destroying everything");
+    }
+
+    // Blocks handed between threads so most are freed by another thread
+    struct Exchange {
+        std::mutex mutex;
+        std::vector<Block> blocks;
+    };
+
+    void cacheRound(size_t thread, std::mt19937 &rng, Exchange &exchange, Failures &failures)
+    {
+        ThreadCache &cache = ThreadCache::instance();
+        std::uniform_int_distribution<size_t> size(1, 600);
+        std::vector<Block> mine;
+        // An odd count leaves the local lists partly used when the thread exits
+        size_t count = 500 + thread * 37;
+        for (size_t i = 0; i < count; i++) {
+            Block block{nullptr, size(rng), static_cast<unsigned char>(thread * 31 + i)};
+            block.data = static_cast<unsigned char *>(cache.allocate(block.size));
+            fill(block);
+            mine.push_back(block);
+        }
+        std::vector<Block> theirs;
+        {
+            std::lock_guard<std::mutex> lock(exchange.mutex);
+            theirs.swap(exchange.blocks);
+            exchange.blocks.assign(mine.begin() + mine.size() / 2, mine.end());
+        }
+        mine.resize(mine.size() / 2);
+        for (const std::vector<Block> *blocks : {&mine, &theirs}) {
+            for (const Block &block : *blocks) {
+                if (!intact(block))
+                    failures.report("ThreadCache block was handed out twice or overwritten");
+                cache.deallocate(block.data, block.size);
+            }
+        }
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    size_t threads = 4;
+    size_t rounds = 20;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                throw std::invalid_argument("Missing value for " + arg);
+            if (arg == "--threads")
+                threads = std::stoul(argv[++i]);
+            else if (arg == "--rounds")
+                rounds = std::stoul(argv[++i]);
+            else
+                throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\nUsage: %s [--threads N] [--rounds N]\n", e.what(), argv[0]);
+        return 1;
+    }
+
+    Failures failures;
+    Exchange exchange;
+    for (size_t round = 0; round < rounds; round++) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 rng(static_cast<unsigned>(round * threads + t));
+                arenaRound(rng, failures);
+                poolRound(rng, failures);
+                cacheRound(t, rng, exchange, failures);
+            });
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+    for (const Block &block : exchange.blocks) {
+        if (!intact(block))
+            failures.report("ThreadCache block was handed out twice or overwritten");
+        ThreadCache::instance().deallocate(block.data, block.size);
+    }
+
+    std::printf("%zu threads, %zu rounds\n", threads, rounds);
+    if (failures.count.load() != 0) {
+        std::printf("%llu failures\n", static_cast<unsigned long long>(failures.count.load()));
+        return 1;
+    }
+    return 0;
+}
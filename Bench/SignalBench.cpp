@@ -0,0 +1,188 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+
+#include "Benchmark.hpp"
+#include "CoalescingSignal.hpp"
+#include "ConcurrentSignal.hpp"
+#include "InplaceFunction.hpp"
+#include "MpscRing.hpp"
+#include "ParallelSignal.hpp"
+#include "QueuedSignal.hpp"
+#include "Signal.hpp"
+
+using namespace cpputils;
+using namespace cpputils::bench;
+
+namespace {
+
+    const std::vector<size_t> slotCounts = {1, 10, 100, 1000};
+    const std::vector<size_t> batchSizes = {64, 1024, 16384};
+
+    template <typename T>
+    T payload()
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+            return std::string(32, 'x');
+        else
+            return T(1);
+    }
+
+    template <typename T>
+    size_t weight(const T &value)
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+            return value.size();
+        else
+            return static_cast<size_t>(value);
+    }
+
+    // size is the slot count; per element cost is the cost of one slot call
+    template <typename T>
+    void signalEmit(State &state)
+    {
+        Signal<T> signal;
+        size_t sink = 0;
+        for (size_t i = 0; i < state.size(); i++)
+            signal.connect([&sink](const T &value) { sink += weight(value); });
+        T value = payload<T>();
+        state.run(state.size(), [&]() {
+            signal.emit(value);
+            doNotOptimize(sink);
+        });
+    }
+
+    template <typename T>
+    void concurrentEmit(State &state)
+    {
+        ConcurrentSignal<T> signal;
+        size_t sink = 0;
+        for (size_t i = 0; i < state.size(); i++)
+            signal.connect([&sink](const T &value) { sink += weight(value); });
+        T value = payload<T>();
+        state.run(state.size(), [&]() {
+            signal.emit(value);
+            doNotOptimize(sink);
+        });
+    }
+
+    // size is the number of threads emitting at once; the timed thread is
+    // one of them, each emit reaches 16 slots
+    template <typename T>
+    void contendedEmit(State &state)
+    {
+        ConcurrentSignal<T> signal;
+        std::atomic<size_t> sink{0};
+        for (size_t i = 0; i < 16; i++)
+            signal.connect([&sink](const T &value) { sink.fetch_add(weight(value), std::memory_order_relaxed); });
+        T value = payload<T>();
+        std::atomic<bool> running{true};
+        std::vector<std::thread> emitters;
+        for (size_t i = 1; i < state.size(); i++) {
+            emitters.emplace_back([&]() {
+                while (running.load(std::memory_order_relaxed))
+                    signal.emit(value);
+            });
+        }
+        state.run(1, [&]() {
+            signal.emit(value);
+        });
+        running.store(false);
+        for (std::thread &emitter : emitters)
+            emitter.join();
+    }
+
+    template <typename T>
+    void parallelEmit(State &state)
+    {
+        static ThreadPool pool;
+        ParallelSignal<size_t(T)> signal(pool, 64);
+        for (size_t i = 0; i < state.size(); i++)
+            signal.connect([](const T &value) { return weight(value); });
+        T value = payload<T>();
+        state.run(state.size(), [&]() {
+            doNotOptimize(signal.emitWith(SumCombiner<size_t>(), value));
+        });
+    }
+
+    template <typename Function>
+    void functionCall(State &state)
+    {
+        size_t sink = 0;
+        std::vector<Function> functions;
+        for (size_t i = 0; i < state.size(); i++)
+            functions.emplace_back([&sink, i](int value) { sink += value + i; });
+        state.run(state.size(), [&]() {
+            for (const Function &function : functions)
+                function(1);
+            doNotOptimize(sink);
+        });
+    }
+
+    // size is the number of values pushed, then drained, per call
+    template <typename T>
+    void ringRoundTrip(State &state)
+    {
+        MpscRing<T> ring(state.size());
+        T value = payload<T>();
+        size_t sink = 0;
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++)
+                ring.tryPush(value);
+            while (ring.pop([&sink](T &popped) { sink += weight(popped); }))
+                ;
+            doNotOptimize(sink);
+        });
+    }
+
+    template <typename T>
+    void queuedRoundTrip(State &state)
+    {
+        QueuedSignal<T> signal(state.size());
+        size_t sink = 0;
+        signal.connect([&sink](const T &value) { sink += weight(value); });
+        T value = payload<T>();
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++)
+                signal.emit(value);
+            signal.dispatch();
+            doNotOptimize(sink);
+        });
+    }
+
+    // size emits are folded into one delivery
+    template <typename T>
+    void coalescingEmit(State &state)
+    {
+        CoalescingSignal<T> signal;
+        size_t sink = 0;
+        signal.connect([&sink](const T &value) { sink += weight(value); });
+        T value = payload<T>();
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++)
+                signal.emit(value);
+            signal.flush();
+            doNotOptimize(sink);
+        });
+    }
+
+    const Registrar signalBenchmarks[] = {
+        {"Signal::emit", "int", slotCounts, signalEmit<int>},
+        {"Signal::emit", "string", slotCounts, signalEmit<std::string>},
+        {"ConcurrentSignal::emit", "int", slotCounts, concurrentEmit<int>},
+        {"ConcurrentSignal::emit", "string", slotCounts, concurrentEmit<std::string>},
+        {"ConcurrentSignal::emit/contended", "int", {1, 2, 4, 8}, contendedEmit<int>},
+        {"ParallelSignal::emitWith", "int", {64, 1024, 16384}, parallelEmit<int>},
+        {"InplaceFunction::call", "int", {16, 1024}, functionCall<InplaceFunction<void(int)>>},
+        {"std::function::call", "int", {16, 1024}, functionCall<std::function<void(int)>>},
+        {"MpscRing::push+pop", "int", batchSizes, ringRoundTrip<int>},
+        {"MpscRing::push+pop", "string", batchSizes, ringRoundTrip<std::string>},
+        {"QueuedSignal::emit+dispatch", "int", batchSizes, queuedRoundTrip<int>},
+        {"QueuedSignal::emit+dispatch", "string", batchSizes, queuedRoundTrip<std::string>},
+        {"CoalescingSignal::emit", "int", batchSizes, coalescingEmit<int>},
+        {"CoalescingSignal::emit", "string", batchSizes, coalescingEmit<std::string>},
+    };
+
+} // namespace
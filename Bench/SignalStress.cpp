@@ -0,0 +1,137 @@
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include "ConcurrentSignal.hpp"
+
+using namespace cpputils;
+
+// Emits a ConcurrentSignal from several threads while another thread keeps
+// connecting, disconnecting and reconnecting slots, and checks that no emit
+// is lost or delivered to a slot its own thread already disconnected.
+// Meant to be run under ThreadSanitizer or AddressSanitizer as well.
+
+namespace {
+
+    struct Failures {
+        std::atomic<u_int64_t> count{0};
+
+        void report(const char *what)
+        {
+            if (count.fetch_add(1) < 10)
+                std::fprintf(stderr, "FAIL: %s\n", what);
+        }
+    };
+
+    // Checks ordering as seen by the thread that connects: its own later
+    // emits reach a new slot and stop reaching a disconnected one
+    void churn(ConcurrentSignal<int> &signal, const std::atomic<bool> &running, Failures &failures, u_int64_t &rounds)
+    {
+        while (running.load(std::memory_order_relaxed)) {
+            // Only this thread emits negative values; the counter is shared
+            // so emitters still walking an old table never touch a dead one
+            auto calls = std::make_shared<std::atomic<u_int64_t>>(0);
+            ConcurrentConnection<int> connection = signal.connect([calls](int value) {
+                if (value < 0)
+                    calls->fetch_add(1, std::memory_order_relaxed);
+            });
+            signal.emit(-1);
+            if (calls->load() != 1)
+                failures.report("slot missed an emit made after connect() returned");
+            connection.disconnect();
+            signal.emit(-1);
+            if (calls->load() != 1)
+                failures.report("slot called by an emit made after disconnect() returned");
+            connection.reconnect();
+            signal.emit(-1);
+            if (calls->load() != 2)
+                failures.report("slot missed an emit made after reconnect() returned");
+            connection.disconnect();
+            signal.collect();
+            std::this_thread::yield();
+            rounds++;
+        }
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 1;
+    size_t threads = 4;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                throw std::invalid_argument("Missing value for " + arg);
+            if (arg == "--seconds")
+                seconds = std::stod(argv[++i]);
+            else if (arg == "--threads")
+                threads = std::stoul(argv[++i]);
+            else
+                throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\nUsage: %s [--seconds S] [--threads N]\n", e.what(), argv[0]);
+        return 1;
+    }
+
+    ConcurrentSignal<int> signal;
+    Failures failures;
+    std::atomic<u_int64_t> received{0};
+    std::atomic<u_int64_t> nested{0};
+    signal.connect([&received](int value) {
+        if (value > 0)
+            received.fetch_add(1, std::memory_order_relaxed);
+    });
+    // Connecting and disconnecting from inside a slot must not deadlock
+    signal.connect([&signal, &nested](int value) {
+        if (value <= 0 || value % 1024 != 0)
+            return;
+        ConcurrentConnection<int> inner = signal.connect([](int) {});
+        inner.disconnect();
+        nested.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    std::atomic<bool> running{true};
+    std::vector<u_int64_t> emitted(threads, 0);
+    std::vector<std::thread> emitters;
+    for (size_t t = 0; t < threads; t++) {
+        emitters.emplace_back([&, t]() {
+            u_int64_t count = 0;
+            while (running.load(std::memory_order_relaxed))
+                signal.emit(static_cast<int>(++count % (1 << 30)) + 1);
+            emitted[t] = count;
+        });
+    }
+    u_int64_t rounds = 0;
+    std::thread churner([&]() {
+        churn(signal, running, failures, rounds);
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running.store(false);
+    for (std::thread &emitter : emitters)
+        emitter.join();
+    churner.join();
+
+    u_int64_t total = 0;
+    for (u_int64_t count : emitted)
+        total += count;
+    if (received.load() != total)
+        failures.report("permanent slot did not receive every emit");
+
+    std::printf("%zu emitting threads: %llu emits, %llu churn rounds, %llu nested connects\n", threads,
+        static_cast<unsigned long long>(total), static_cast<unsigned long long>(rounds),
+        static_cast<unsigned long long>(nested.load()));
+    if (failures.count.load() != 0) {
+        std::printf("%llu failures\n", static_cast<unsigned long long>(failures.count.load()));
+        return 1;
+    }
+    return 0;
+}
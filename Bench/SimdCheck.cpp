@@ -0,0 +1,172 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.hpp"
+#include "Gradient.hpp"
+#include "PixelKernels.hpp"
+#ifdef CPPUTILS_SIMD_CHECK_MATH
+    #include "VectorKernels.hpp"
+#endif
+
+using namespace cpputils;
+
+// Runs every dispatched kernel at every SIMD level this CPU supports and
+// checks that the output is bit for bit the one of the scalar level. Sizes
+// cover empty input, partial vectors and tails of every length.
+
+namespace {
+
+    struct Failures {
+        u_int64_t count = 0;
+
+        void report(const std::string &kernel, size_t size, SimdLevel level)
+        {
+            if (count++ < 10)
+                std::fprintf(stderr, "FAIL: %s, %zu elements, %s differs from scalar\n", kernel.c_str(), size,
+                    toString(level));
+        }
+    };
+
+    template <typename T>
+    bool sameBits(const std::vector<T> &a, const std::vector<T> &b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    // Runs the kernel at every level and compares each result with the scalar one
+    template <typename Run>
+    void compareLevels(const std::string &kernel, size_t size, Run &&run, Failures &failures)
+    {
+        setSimdLevel(SimdLevel::Scalar);
+        auto expected = run();
+        for (int level = 1; level <= static_cast<int>(cpuSimdLevel()); level++) {
+            setSimdLevel(static_cast<SimdLevel>(level));
+            if (!sameBits(run(), expected))
+                failures.report(kernel, size, static_cast<SimdLevel>(level));
+        }
+        resetSimdLevel();
+    }
+
+    void checkPixels(std::mt19937 &rng, size_t size, Failures &failures)
+    {
+        // Out of range values exercise the clamping in pack
+        std::uniform_real_distribution<float> value(-0.25f, 1.25f);
+        std::uniform_real_distribution<float> alpha(0.0f, 1.0f);
+        std::vector<Color4f> fg(size);
+        std::vector<Color4f> bg(size);
+        std::vector<Color32> packed(size);
+        for (size_t i = 0; i < size; i++) {
+            fg[i] = Color4f(value(rng), value(rng), value(rng), alpha(rng));
+            bg[i] = Color4f(value(rng), value(rng), value(rng), alpha(rng));
+            // Fully transparent pairs take the outAlpha == 0 branch
+            if (i % 7 == 0)
+                fg[i].opacity = bg[i].opacity = 0.0f;
+            packed[i] = Color32(static_cast<u_int32_t>(rng()));
+        }
+
+        compareLevels("blendPixels", size, [&]() {
+            std::vector<Color4f> out(size);
+            blendPixels(fg.data(), bg.data(), out.data(), size);
+            return out;
+        }, failures);
+        compareLevels("packPixels", size, [&]() {
+            std::vector<Color32> out(size);
+            packPixels(fg.data(), out.data(), size);
+            return out;
+        }, failures);
+        compareLevels("unpackPixels", size, [&]() {
+            std::vector<Color4f> out(size);
+            unpackPixels(packed.data(), out.data(), size);
+            return out;
+        }, failures);
+    }
+
+    // Values around and beyond the range, NaN and infinities included,
+    // must pick the same table entry at every level
+    void checkGradient(std::mt19937 &rng, size_t size, Failures &failures)
+    {
+        static const Gradient4f gradient = []() {
+            Gradient4f turbo = Gradient4f::turbo(1000);
+            turbo.setRange(-3.0f, 7.0f);
+            return turbo;
+        }();
+        std::uniform_real_distribution<float> value(-4.0f, 8.0f);
+        std::vector<float> values(size);
+        for (size_t i = 0; i < size; i++)
+            values[i] = value(rng);
+        const float special[] = {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity(), -3.0f, 7.0f};
+        for (size_t i = 0; i < size && i < std::size(special); i++)
+            values[i * 3 % size] = special[i];
+
+        compareLevels("Gradient::map(Color4f)", size, [&]() {
+            std::vector<Color4f> out(size);
+            gradient.map(values.data(), size, out.data());
+            return out;
+        }, failures);
+        compareLevels("Gradient::map(Color32)", size, [&]() {
+            std::vector<Color32> out(size);
+            gradient.map(values.data(), size, out.data());
+            return out;
+        }, failures);
+    }
+
+#ifdef CPPUTILS_SIMD_CHECK_MATH
+    void checkVectors(std::mt19937 &rng, size_t size, Failures &failures)
+    {
+        std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+        std::vector<Math::Vector3f> a(size);
+        std::vector<Math::Vector3f> b(size);
+        for (size_t i = 0; i < size; i++) {
+            a[i] = Math::Vector3f(value(rng), value(rng), value(rng));
+            b[i] = Math::Vector3f(value(rng), value(rng), value(rng));
+        }
+
+        compareLevels("addVectors", size, [&]() {
+            std::vector<Math::Vector3f> out(size);
+            Math::addVectors(a.data(), b.data(), out.data(), size);
+            return out;
+        }, failures);
+        compareLevels("scaleVectors", size, [&]() {
+            std::vector<Math::Vector3f> out(size);
+            Math::scaleVectors(a.data(), 1.7f, out.data(), size);
+            return out;
+        }, failures);
+        compareLevels("dotVectors", size, [&]() {
+            std::vector<float> out(size);
+            Math::dotVectors(a.data(), b.data(), out.data(), size);
+            return out;
+        }, failures);
+    }
+#endif
+
+}
+
+int main()
+{
+    Failures failures;
+    std::mt19937 rng(42);
+    std::vector<size_t> sizes = {0, 1000, 1023};
+    for (size_t size = 1; size <= 33; size++)
+        sizes.push_back(size);
+    for (size_t size : sizes) {
+        checkPixels(rng, size, failures);
+        checkGradient(rng, size, failures);
+#ifdef CPPUTILS_SIMD_CHECK_MATH
+        checkVectors(rng, size, failures);
+#endif
+    }
+
+    std::printf("Compared scalar up to %s\n", toString(cpuSimdLevel()));
+    if (failures.count != 0) {
+        std::printf("%llu failures\n", static_cast<unsigned long long>(failures.count));
+        return 1;
+    }
+    return 0;
+}
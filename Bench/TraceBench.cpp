@@ -0,0 +1,56 @@
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "Tracer.hpp"
+
+using namespace cpputils;
+using namespace cpputils::bench;
+
+namespace {
+
+    void clockNow(State &state)
+    {
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++)
+                doNotOptimize(TraceClock::now());
+        });
+    }
+
+    // The cost every instrumented call pays while no trace is running
+    void zoneIdle(State &state)
+    {
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++) {
+                TraceZone zone("zone");
+                doNotOptimize(i);
+            }
+        });
+    }
+
+    // Records size zones, then drains them as JSON to /dev/null, so the per
+    // element cost is one zone on the hot path plus its share of the export
+    void zoneRecording(State &state)
+    {
+#ifdef __linux__
+        Tracer &tracer = Tracer::instance();
+        tracer.start("/dev/null", std::chrono::hours(1));
+        state.run(state.size(), [&]() {
+            for (size_t i = 0; i < state.size(); i++) {
+                TraceZone zone("zone");
+                doNotOptimize(i);
+            }
+            tracer.flush();
+        });
+        tracer.stop();
+#else
+        (void)state;
+#endif
+    }
+
+    const Registrar traceBenchmarks[] = {
+        {"TraceClock::now", "ticks", {1024}, clockNow},
+        {"TraceZone", "idle", {1024}, zoneIdle},
+        {"TraceZone+flush", "chrome-json", {1024, 8192}, zoneRecording},
+    };
+
+} // namespace
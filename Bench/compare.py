@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compares two cpputils_bench JSON reports and flags regressions.
+
+    cpputils_bench --json baseline.json          # on the reference build
+    cpputils_bench --json current.json           # on the candidate build
+    compare.py baseline.json current.json [--threshold 10] [--update]
+
+Benchmarks are matched by name, type and size. Cycles per element are
+compared when both reports have them, nanoseconds per element otherwise.
+The exit status is 1 when any benchmark got slower by more than the
+threshold (in percent). --update overwrites the baseline with the current
+report once the comparison passes.
+"""
+
+import argparse
+import json
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as file:
+        report = json.load(file)
+    return {(b["name"], b["type"], b["size"]): b for b in report["benchmarks"]}
+
+
+def metric(baseline, current):
+    if baseline.get("cyclesPerElement") is not None and current.get("cyclesPerElement") is not None:
+        return "cycles", baseline["cyclesPerElement"], current["cyclesPerElement"]
+    return "ns", baseline["nsPerElement"], current["nsPerElement"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag cpputils_bench regressions against a baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown in percent reported as a regression (default 10)")
+    parser.add_argument("--update", action="store_true",
+                        help="replace the baseline with the current report if there is no regression")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    limit = 1 + args.threshold / 100
+
+    regressions = 0
+    for key in sorted(baseline.keys() & current.keys()):
+        unit, before, after = metric(baseline[key], current[key])
+        ratio = after / before if before > 0 else 1.0
+        if ratio > limit:
+            status = "REGRESSION"
+            regressions += 1
+        elif ratio < 1 / limit:
+            status = "improved"
+        else:
+            status = ""
+        name = "/".join(str(part) for part in key)
+        print(f"{name:<56} {before:12.3f} -> {after:12.3f} {unit}/elem {ratio - 1:+8.1%} {status}")
+
+    for key in sorted(baseline.keys() - current.keys()):
+        print(f"{'/'.join(str(part) for part in key):<56} missing from the current report")
+    for key in sorted(current.keys() - baseline.keys()):
+        print(f"{'/'.join(str(part) for part in key):<56} new, no baseline")
+
+    if regressions:
+        print(f"{regressions} regression(s) above {args.threshold:g}%", file=sys.stderr)
+        return 1
+    if args.update:
+        shutil.copyfile(args.current, args.baseline)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "Benchmark.hpp"
+
+using namespace cpputils::bench;
+
+static void usage(const char *program)
+{
+    std::fprintf(stderr,
+        "Usage: %s [--filter TEXT] [--min-time MS] [--repetitions N] [--json FILE] [--list]\n"
+        "  --filter       only run benchmarks whose \"name/type/size\" contains TEXT\n"
+        "  --min-time     minimum duration of one repetition, in milliseconds (default 20)\n"
+        "  --repetitions  repetitions per benchmark, the median is reported (default 5)\n"
+        "  --json         write the results as JSON to FILE (- for stdout)\n"
+        "  --list         print the benchmark names and exit\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::string jsonPath;
+    bool list = false;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--filter")
+                options.filter = value();
+            else if (arg == "--min-time")
+                options.minTimeMs = std::stod(value());
+            else if (arg == "--repetitions")
+                options.repetitions = std::stoi(value());
+            else if (arg == "--json")
+                jsonPath = value();
+            else if (arg == "--list")
+                list = true;
+            else
+                throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        usage(argv[0]);
+        return 1;
+    }
+
+    CycleCounter counter;
+    // Keep stdout clean for the JSON report when it goes there
+    std::ostream &table = jsonPath == "-" ? std::cerr : std::cout;
+    if (!list && !counter.available())
+        table << "note: hardware cycle counter unavailable, reporting time only\n";
+
+    // Registration order depends on static initialization across files
+    std::vector<Benchmark> &benchmarks = registry();
+    std::stable_sort(benchmarks.begin(), benchmarks.end(), [](const Benchmark &a, const Benchmark &b) {
+        return a.name < b.name;
+    });
+
+    std::vector<Result> results;
+    for (const Benchmark &benchmark : benchmarks) {
+        for (size_t size : benchmark.sizes) {
+            std::string id = benchmark.name + "/" + benchmark.type + "/" + std::to_string(size);
+            if (!options.filter.empty() && id.find(options.filter) == std::string::npos)
+                continue;
+            if (list) {
+                std::cout << id << "\n";
+                continue;
+            }
+            State state(size, options, counter);
+            try {
+                benchmark.function(state);
+            } catch (const std::exception &e) {
+                std::fprintf(stderr, "%s: %s\n", id.c_str(), e.what());
+                continue;
+            }
+            if (!state.ran())
+                continue;
+            Result result = state.result();
+            result.name = benchmark.name;
+            result.type = benchmark.type;
+            result.size = size;
+            results.push_back(result);
+
+            char line[256];
+            std::snprintf(line, sizeof(line), "%-56s %12.3f ns/elem", id.c_str(), result.nsPerElement);
+            table << line;
+            if (result.cyclesPerElement >= 0) {
+                std::snprintf(line, sizeof(line), " %12.3f cycles/elem", result.cyclesPerElement);
+                table << line;
+            }
+            if (result.bytesPerSecond > 0) {
+                std::snprintf(line, sizeof(line), " %10.1f MB/s", result.bytesPerSecond / 1e6);
+                table << line;
+            }
+            table << std::endl;
+        }
+    }
+
+    if (jsonPath == "-") {
+        writeJson(std::cout, results, options, counter.available());
+    } else if (!jsonPath.empty()) {
+        std::ofstream file(jsonPath);
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", jsonPath.c_str());
+            return 1;
+        }
+        writeJson(file, results, options, counter.available());
+    }
+    return 0;
+}
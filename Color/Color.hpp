@@ -3,13 +3,47 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdio>
 #include <cmath>
+#include <memory_resource>
+#include <type_traits>
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
 
 namespace cpputils {
 
+    namespace detail {
+
+        // Appends value formatted like std::to_string, without a temporary
+        template <typename String, typename T>
+        void appendNumber(String &out, T value)
+        {
+            char buffer[64];
+            std::to_chars_result result;
+            if constexpr (std::is_integral_v<T>)
+                result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            else
+                result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6);
+            if (result.ec == std::errc())
+                out.append(buffer, result.ptr);
+            else
+                out.append(std::to_string(value).c_str());
+        }
+
+        inline u_int8_t parseHexByte(std::string_view digits)
+        {
+            unsigned value = 0;
+            auto result = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+            if (result.ec != std::errc() || result.ptr != digits.data() + digits.size())
+                throw std::invalid_argument("Invalid hex color");
+            return static_cast<u_int8_t>(value);
+        }
+
+    } // namespace detail
+
     template <typename T>
     struct Color3 {
         Color3(T r = 0, T g = 0, T b = 0)
@@ -24,26 +58,26 @@ namespace cpputils {
         T g = 0;
         T b = 0;
 
-        void fromHex(const std::string &hex)
+        void fromHex(std::string_view hex)
         {
-            if (hex[0] == '#')
-            {
-                fromHex(hex.substr(1));
-                return;
-            }
+            if (!hex.empty() && hex[0] == '#')
+                hex.remove_prefix(1);
             if (hex.size() != 6)
             {
                 throw std::invalid_argument("Invalid hex color");
             }
-            r = std::stoi(hex.substr(0, 2), nullptr, 16) / 255.0;
-            g = std::stoi(hex.substr(2, 2), nullptr, 16) / 255.0;
-            b = std::stoi(hex.substr(4, 2), nullptr, 16) / 255.0;
+            r = detail::parseHexByte(hex.substr(0, 2)) / 255.0;
+            g = detail::parseHexByte(hex.substr(2, 2)) / 255.0;
+            b = detail::parseHexByte(hex.substr(4, 2)) / 255.0;
         }
 
         std::string toHex() const
         {
             char buffer[8];
-            sprintf(buffer, "%02X%02X%02X", r * 255, g * 255, b * 255);
+            std::snprintf(buffer, sizeof(buffer), "%02X%02X%02X",
+                static_cast<unsigned>(static_cast<u_int8_t>(r * 255)),
+                static_cast<unsigned>(static_cast<u_int8_t>(g * 255)),
+                static_cast<unsigned>(static_cast<u_int8_t>(b * 255)));
             return std::string(buffer);
         }
 
@@ -71,7 +105,7 @@ namespace cpputils {
             return Color3(r - other.r, g - other.g, b - other.b);
         }
 
-        Color3 operator*(float factor) const
+        Color3 operator*(T factor) const
         {
             return Color3(r * factor, g * factor, b * factor);
         }
@@ -89,7 +123,7 @@ namespace cpputils {
             return *this;
         }
 
-        Color3 operator*=(float factor)
+        Color3 operator*=(T factor)
         {
             r *= factor;
             g *= factor;
@@ -97,7 +131,7 @@ namespace cpputils {
             return *this;
         }
 
-        Color3 operator/=(float factor)
+        Color3 operator/=(T factor)
         {
             r /= factor;
             g /= factor;
@@ -120,18 +154,39 @@ namespace cpputils {
 
         std::string toString() const
         {
-            return "Color3(" + std::to_string(r) + ", " + std::to_string(g) + ", " + std::to_string(b) + ")";
+            std::string result;
+            appendTo(result);
+            return result;
+        }
+
+        std::pmr::string toString(std::pmr::memory_resource *resource) const
+        {
+            std::pmr::string result(resource);
+            appendTo(result);
+            return result;
+        }
+
+        // Appends the toString() text to an existing std::string or std::pmr::string
+        template <typename String>
+        void appendTo(String &out) const
+        {
+            out.reserve(out.size() + 40);
+            out += "Color3(";
+            detail::appendNumber(out, r);
+            out += ", ";
+            detail::appendNumber(out, g);
+            out += ", ";
+            detail::appendNumber(out, b);
+            out += ")";
         }
 
         u_int32_t toInt() const
         {
-            u_int8_t c[4] = {
-                r * 255,
-                g * 255,
-                b * 255,
-                1
-            };
-            return *(u_int32_t *)&c;
+            // R in the low byte, A in the high byte, independent of endianness
+            return static_cast<u_int32_t>(static_cast<u_int8_t>(r * 255))
+                | static_cast<u_int32_t>(static_cast<u_int8_t>(g * 255)) << 8
+                | static_cast<u_int32_t>(static_cast<u_int8_t>(b * 255)) << 16
+                | static_cast<u_int32_t>(1) << 24;
         }
     };
 
@@ -196,7 +251,7 @@ namespace cpputils {
             opacity = outAlpha;
         }
 
-        Color operator*(float factor) const
+        Color operator*(T factor) const
         {
             return Color(color * factor, opacity * factor);
         }
@@ -218,14 +273,14 @@ namespace cpputils {
             return *this;
         }
 
-        Color operator*=(float factor)
+        Color operator*=(T factor)
         {
             color *= factor;
             opacity *= factor;
             return *this;
         }
 
-        Color operator /=(float factor)
+        Color operator /=(T factor)
         {
             color /= factor;
             opacity /= factor;
@@ -234,27 +289,44 @@ namespace cpputils {
 
         std::string toString() const
         {
-            return "Color(" + color.toString() + ", " + std::to_string(opacity) + ")";
+            std::string result;
+            appendTo(result);
+            return result;
+        }
+
+        std::pmr::string toString(std::pmr::memory_resource *resource) const
+        {
+            std::pmr::string result(resource);
+            appendTo(result);
+            return result;
+        }
+
+        template <typename String>
+        void appendTo(String &out) const
+        {
+            out.reserve(out.size() + 56);
+            out += "Color(";
+            color.appendTo(out);
+            out += ", ";
+            detail::appendNumber(out, opacity);
+            out += ")";
         }
 
         u_int32_t toInt() const
         {
-            u_int8_t c[4] = {
-                color.r * 255,
-                color.g * 255,
-                color.b * 255,
-                opacity * 255
-            };
-            return *(u_int32_t *)&c;
+            return static_cast<u_int32_t>(static_cast<u_int8_t>(color.r * 255))
+                | static_cast<u_int32_t>(static_cast<u_int8_t>(color.g * 255)) << 8
+                | static_cast<u_int32_t>(static_cast<u_int8_t>(color.b * 255)) << 16
+                | static_cast<u_int32_t>(static_cast<u_int8_t>(opacity * 255)) << 24;
         }
 
         Color clamp() const
         {
             return Color(
-                std::clamp(color.r, 0.0f, 1.0f),
-                std::clamp(color.g, 0.0f, 1.0f),
-                std::clamp(color.b, 0.0f, 1.0f),
-                std::clamp(opacity, 0.0f, 1.0f));
+                std::clamp(color.r, T(0), T(1)),
+                std::clamp(color.g, T(0), T(1)),
+                std::clamp(color.b, T(0), T(1)),
+                std::clamp(opacity, T(0), T(1)));
         }
     };
 
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "Color.hpp"
+
+namespace cpputils {
+
+    // Fixed-size writable file mapping. The encoders write straight into
+    // data(); close() trims the file down to the bytes actually produced.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const std::string &path, size_t capacity)
+        {
+            open(path, capacity);
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile()
+        {
+            close(_capacity);
+        }
+
+        void open(const std::string &path, size_t capacity)
+        {
+            close(_capacity);
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (_fd < 0)
+                throw std::runtime_error("Cannot open file: " + path + ": " + std::strerror(errno));
+            if (capacity > 0 && ::ftruncate(_fd, capacity) != 0) {
+                ::close(_fd);
+                _fd = -1;
+                throw std::runtime_error("Cannot resize file: " + path + ": " + std::strerror(errno));
+            }
+            if (capacity > 0) {
+                void *data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+                if (data == MAP_FAILED) {
+                    ::close(_fd);
+                    _fd = -1;
+                    throw std::runtime_error("Cannot map file: " + path + ": " + std::strerror(errno));
+                }
+                _data = static_cast<u_int8_t *>(data);
+            }
+            _capacity = capacity;
+        }
+
+        void close(size_t used)
+        {
+            if (_data)
+                ::munmap(_data, _capacity);
+            if (_fd >= 0) {
+                if (used < _capacity) {
+                    int result = ::ftruncate(_fd, used);
+                    (void)result;
+                }
+                ::close(_fd);
+            }
+            _data = nullptr;
+            _fd = -1;
+            _capacity = 0;
+        }
+
+        u_int8_t *data() const
+        {
+            return _data;
+        }
+
+        size_t capacity() const
+        {
+            return _capacity;
+        }
+
+    private:
+        int _fd = -1;
+        u_int8_t *_data = nullptr;
+        size_t _capacity = 0;
+    };
+
+    namespace detail {
+
+        template <typename T>
+        inline u_int8_t toByte(T value)
+        {
+            return static_cast<u_int8_t>(std::clamp(value, T(0), T(1)) * T(255) + T(0.5));
+        }
+
+    } // namespace detail
+
+    // Shared row bookkeeping for the encoders: every encoder writes into a
+    // caller-provided buffer and only keeps constant-size state.
+    class ImageEncoder {
+    public:
+        ImageEncoder(u_int8_t *buffer, size_t capacity)
+            : _buffer(buffer), _capacity(capacity)
+        {
+        }
+
+        size_t size() const
+        {
+            return _pos;
+        }
+
+    protected:
+        void start(size_t width, size_t height, int channels)
+        {
+            if (channels != 3 && channels != 4)
+                throw std::invalid_argument("Images must have 3 or 4 channels");
+            _width = width;
+            _height = height;
+            _channels = channels;
+            _row = 0;
+            _pos = 0;
+        }
+
+        void nextRow(size_t maxRowBytes)
+        {
+            if (_row >= _height)
+                throw std::runtime_error("Too many rows written to image");
+            reserve(maxRowBytes);
+            _row++;
+        }
+
+        void reserve(size_t bytes)
+        {
+            if (_capacity - _pos < bytes)
+                throw std::length_error("Image buffer is too small");
+        }
+
+        void checkComplete() const
+        {
+            if (_row != _height)
+                throw std::runtime_error("Image is missing rows");
+        }
+
+        void put(u_int8_t byte)
+        {
+            _buffer[_pos++] = byte;
+        }
+
+        u_int8_t *_buffer = nullptr;
+        size_t _capacity = 0;
+        size_t _pos = 0;
+        size_t _width = 0;
+        size_t _height = 0;
+        size_t _row = 0;
+        int _channels = 3;
+    };
+
+    // Binary PPM (P6) for 3 channels, PAM (P7) for 4 channels
+    class PnmEncoder : public ImageEncoder {
+    public:
+        PnmEncoder(u_int8_t *buffer, size_t capacity)
+            : ImageEncoder(buffer, capacity)
+        {
+        }
+
+        static size_t maxSize(size_t width, size_t height, int channels)
+        {
+            return headerSize + width * height * channels;
+        }
+
+        void begin(size_t width, size_t height, int channels = 3)
+        {
+            start(width, height, channels);
+            char header[headerSize];
+            int length;
+            if (channels == 3)
+                length = snprintf(header, sizeof(header), "P6\n%zu %zu\n255\n", width, height);
+            else
+                length = snprintf(header, sizeof(header),
+                    "P7\nWIDTH %zu\nHEIGHT %zu\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width, height);
+            reserve(length);
+            std::memcpy(_buffer, header, length);
+            _pos = length;
+        }
+
+        template <typename T>
+        void writeRow(const Color3<T> *row)
+        {
+            nextRow(_width * _channels);
+            for (size_t x = 0; x < _width; x++)
+                pixel(detail::toByte(row[x].r), detail::toByte(row[x].g), detail::toByte(row[x].b), 255);
+        }
+
+        template <typename T>
+        void writeRow(const Color<T> *row)
+        {
+            nextRow(_width * _channels);
+            for (size_t x = 0; x < _width; x++) {
+                const Color3<T> &color = row[x].color;
+                pixel(detail::toByte(color.r), detail::toByte(color.g), detail::toByte(color.b),
+                    detail::toByte(row[x].opacity));
+            }
+        }
+
+        // Packed RGBA8, four bytes per pixel in R, G, B, A order
+        void writeRow(const u_int8_t *rgba)
+        {
+            nextRow(_width * _channels);
+            if (_channels == 4) {
+                std::memcpy(_buffer + _pos, rgba, _width * 4);
+                _pos += _width * 4;
+                return;
+            }
+            for (size_t x = 0; x < _width; x++, rgba += 4)
+                pixel(rgba[0], rgba[1], rgba[2], rgba[3]);
+        }
+
+        size_t finish()
+        {
+            checkComplete();
+            return _pos;
+        }
+
+    private:
+        static constexpr size_t headerSize = 128;
+
+        void pixel(u_int8_t r, u_int8_t g, u_int8_t b, u_int8_t a)
+        {
+            u_int8_t *out = _buffer + _pos;
+            out[0] = r;
+            out[1] = g;
+            out[2] = b;
+            if (_channels == 4)
+                out[3] = a;
+            _pos += _channels;
+        }
+    };
+
+    // Quite OK Image format, see https://qoiformat.org/qoi-specification.pdf
+    class QoiEncoder : public ImageEncoder {
+    public:
+        QoiEncoder(u_int8_t *buffer, size_t capacity)
+            : ImageEncoder(buffer, capacity)
+        {
+        }
+
+        static size_t maxSize(size_t width, size_t height, int channels)
+        {
+            return 14 + width * height * (channels + 1) + sizeof(endMarker);
+        }
+
+        void begin(size_t width, size_t height, int channels = 4)
+        {
+            if (width > 0xFFFFFFFFu || height > 0xFFFFFFFFu)
+                throw std::invalid_argument("Image is too large for QOI");
+            start(width, height, channels);
+            reserve(14);
+            put('q');
+            put('o');
+            put('i');
+            put('f');
+            put32(width);
+            put32(height);
+            put(channels);
+            put(0);
+            std::memset(_index, 0, sizeof(_index));
+            _prev = Pixel{0, 0, 0, 255};
+            _run = 0;
+        }
+
+        template <typename T>
+        void writeRow(const Color3<T> *row)
+        {
+            nextRow(rowBytes());
+            for (size_t x = 0; x < _width; x++)
+                pixel(Pixel{detail::toByte(row[x].r), detail::toByte(row[x].g), detail::toByte(row[x].b), 255});
+        }
+
+        template <typename T>
+        void writeRow(const Color<T> *row)
+        {
+            nextRow(rowBytes());
+            for (size_t x = 0; x < _width; x++) {
+                const Color3<T> &color = row[x].color;
+                u_int8_t alpha = _channels == 4 ? detail::toByte(row[x].opacity) : 255;
+                pixel(Pixel{detail::toByte(color.r), detail::toByte(color.g), detail::toByte(color.b), alpha});
+            }
+        }
+
+        // Packed RGBA8, four bytes per pixel in R, G, B, A order
+        void writeRow(const u_int8_t *rgba)
+        {
+            nextRow(rowBytes());
+            for (size_t x = 0; x < _width; x++, rgba += 4)
+                pixel(Pixel{rgba[0], rgba[1], rgba[2], _channels == 4 ? rgba[3] : u_int8_t(255)});
+        }
+
+        size_t finish()
+        {
+            checkComplete();
+            reserve((_run > 0) + sizeof(endMarker));
+            if (_run > 0) {
+                put(opRun | (_run - 1));
+                _run = 0;
+            }
+            std::memcpy(_buffer + _pos, endMarker, sizeof(endMarker));
+            _pos += sizeof(endMarker);
+            return _pos;
+        }
+
+    private:
+        struct Pixel {
+            u_int8_t r;
+            u_int8_t g;
+            u_int8_t b;
+            u_int8_t a;
+
+            bool operator==(const Pixel &other) const
+            {
+                return r == other.r && g == other.g && b == other.b && a == other.a;
+            }
+        };
+
+        static constexpr u_int8_t opIndex = 0x00;
+        static constexpr u_int8_t opDiff = 0x40;
+        static constexpr u_int8_t opLuma = 0x80;
+        static constexpr u_int8_t opRun = 0xC0;
+        static constexpr u_int8_t opRgb = 0xFE;
+        static constexpr u_int8_t opRgba = 0xFF;
+        static constexpr u_int8_t endMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+        // A run left open by the previous row is flushed by this one
+        size_t rowBytes() const
+        {
+            return _width * (_channels + 1) + 1;
+        }
+
+        void put32(u_int32_t value)
+        {
+            put(value >> 24);
+            put(value >> 16);
+            put(value >> 8);
+            put(value);
+        }
+
+        void pixel(const Pixel &px)
+        {
+            if (px == _prev) {
+                if (++_run == 62) {
+                    put(opRun | (_run - 1));
+                    _run = 0;
+                }
+                return;
+            }
+            if (_run > 0) {
+                put(opRun | (_run - 1));
+                _run = 0;
+            }
+            int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+            if (_index[hash] == px) {
+                put(opIndex | hash);
+            } else {
+                _index[hash] = px;
+                if (px.a == _prev.a) {
+                    int8_t vr = px.r - _prev.r;
+                    int8_t vg = px.g - _prev.g;
+                    int8_t vb = px.b - _prev.b;
+                    int8_t vgr = vr - vg;
+                    int8_t vgb = vb - vg;
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        put(opDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        put(opLuma | (vg + 32));
+                        put((vgr + 8) << 4 | (vgb + 8));
+                    } else {
+                        put(opRgb);
+                        put(px.r);
+                        put(px.g);
+                        put(px.b);
+                    }
+                } else {
+                    put(opRgba);
+                    put(px.r);
+                    put(px.g);
+                    put(px.b);
+                    put(px.a);
+                }
+            }
+            _prev = px;
+        }
+
+        Pixel _index[64] = {};
+        Pixel _prev = {0, 0, 0, 255};
+        int _run = 0;
+    };
+
+} // namespace cpputils
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <string_view>
+#include <initializer_list>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include "Color.hpp"
+#include "PackedColor.hpp"
+#include "PixelKernels.hpp"
+#include "Trace.hpp"
+
+namespace cpputils {
+
+    namespace detail {
+
+        template <typename T>
+        inline T srgbToLinear(T c)
+        {
+            return c <= T(0.04045) ? c / T(12.92) : std::pow((c + T(0.055)) / T(1.055), T(2.4));
+        }
+
+        template <typename T>
+        inline T linearToSrgb(T c)
+        {
+            return c <= T(0.0031308) ? c * T(12.92) : T(1.055) * std::pow(c, T(1) / T(2.4)) - T(0.055);
+        }
+
+        // sRGB <-> OKLab, see https://bottosson.github.io/posts/oklab/
+        template <typename T>
+        inline Color3<T> srgbToOklab(const Color3<T> &c)
+        {
+            T r = srgbToLinear(c.r);
+            T g = srgbToLinear(c.g);
+            T b = srgbToLinear(c.b);
+            T l = std::cbrt(T(0.4122214708) * r + T(0.5363325363) * g + T(0.0514459929) * b);
+            T m = std::cbrt(T(0.2119034982) * r + T(0.6806995451) * g + T(0.1073969566) * b);
+            T s = std::cbrt(T(0.0883024619) * r + T(0.2817188376) * g + T(0.6299787005) * b);
+            return Color3<T>(
+                T(0.2104542553) * l + T(0.7936177850) * m - T(0.0040720468) * s,
+                T(1.9779984951) * l - T(2.4285922050) * m + T(0.4505937099) * s,
+                T(0.0259040371) * l + T(0.7827717662) * m - T(0.8086757660) * s);
+        }
+
+        template <typename T>
+        inline Color3<T> oklabToSrgb(const Color3<T> &c)
+        {
+            T l = c.r + T(0.3963377774) * c.g + T(0.2158037573) * c.b;
+            T m = c.r - T(0.1055613458) * c.g - T(0.0638541728) * c.b;
+            T s = c.r - T(0.0894841775) * c.g - T(1.2914855480) * c.b;
+            l = l * l * l;
+            m = m * m * m;
+            s = s * s * s;
+            return Color3<T>(
+                linearToSrgb(T(4.0767416621) * l - T(3.3077115913) * m + T(0.2309699292) * s),
+                linearToSrgb(T(-1.2684380046) * l + T(2.6097574011) * m - T(0.3413193965) * s),
+                linearToSrgb(T(-0.0041960863) * l - T(0.7034186147) * m + T(1.7076147010) * s));
+        }
+
+    } // namespace detail
+
+    // Multi-stop gradient baked into a fixed-size lookup table. Stops are
+    // interpolated once at bake time; map() is then a clamp, a multiply and a
+    // table load per sample, vectorized for Gradient<float> through the
+    // pixel kernels (gathers on AVX2 and AVX-512).
+    template <typename T>
+    class Gradient {
+    public:
+        enum class Interpolation {
+            Linear,
+            Cubic,
+            Perceptual
+        };
+
+        struct Stop {
+            T position;
+            Color<T> color;
+        };
+
+        // A single default-colour stop, so map() and at() are always valid
+        Gradient()
+            : Gradient({Stop{0, Color<T>()}}, 2)
+        {
+        }
+        Gradient(const std::vector<Stop> &stops, size_t size = 256, Interpolation mode = Interpolation::Linear)
+        {
+            setStops(stops, size, mode);
+        }
+        ~Gradient() = default;
+
+        void setStops(const std::vector<Stop> &stops, size_t size = 256, Interpolation mode = Interpolation::Linear)
+        {
+            if (stops.empty())
+                throw std::invalid_argument("Gradient needs at least one stop");
+            if (size < 2)
+                throw std::invalid_argument("Gradient table needs at least two entries");
+            _stops = stops;
+            std::stable_sort(_stops.begin(), _stops.end(), [](const Stop &a, const Stop &b) {
+                return a.position < b.position;
+            });
+            _mode = mode;
+            bake(size);
+        }
+
+        // Input values mapped onto the first and last table entries. Until
+        // this is called the range follows the stop positions; afterwards
+        // setStops() keeps it.
+        void setRange(T min, T max)
+        {
+            if (!(max > min))
+                throw std::invalid_argument("Invalid gradient range");
+            _min = min;
+            _max = max;
+            _customRange = true;
+            updateScale();
+        }
+
+        size_t size() const
+        {
+            return _lut.size();
+        }
+
+        // Interpolates the stops directly, without the table
+        Color<T> sample(T position) const
+        {
+            if (_stops.empty())
+                throw std::runtime_error("Gradient has no stops");
+            if (position <= _stops.front().position)
+                return _stops.front().color;
+            if (position >= _stops.back().position)
+                return _stops.back().color;
+            size_t i = 1;
+            while (_stops[i].position < position)
+                i++;
+            const Stop &a = _stops[i - 1];
+            const Stop &b = _stops[i];
+            T span = b.position - a.position;
+            T t = span > 0 ? (position - a.position) / span : T(1);
+            switch (_mode) {
+            case Interpolation::Cubic: {
+                const Stop &prev = i >= 2 ? _stops[i - 2] : a;
+                const Stop &next = i + 1 < _stops.size() ? _stops[i + 1] : b;
+                return cubic(prev.color, a.color, b.color, next.color, t).clamp();
+            }
+            case Interpolation::Perceptual: {
+                Color3<T> la = detail::srgbToOklab(a.color.color);
+                Color3<T> lb = detail::srgbToOklab(b.color.color);
+                Color3<T> mixed = detail::oklabToSrgb(la + (lb - la) * t);
+                return Color<T>(mixed, a.color.opacity + (b.color.opacity - a.color.opacity) * t).clamp();
+            }
+            default:
+                return a.color * (1 - t) + b.color * t;
+            }
+        }
+
+        const Color<T> &at(T value) const
+        {
+            return _lut[index(value)];
+        }
+
+        void map(const T *values, size_t count, Color<T> *out) const
+        {
+            CPPUTILS_TRACE_ZONE("Gradient::map");
+            if constexpr (std::is_same_v<T, float>) {
+                detail::pixelKernels().lookupColors(values, count, _min, _scale, _lut.data(), _lut.size(), out);
+            } else {
+                const Color<T> *lut = _lut.data();
+                for (size_t i = 0; i < count; i++)
+                    out[i] = lut[index(values[i])];
+            }
+        }
+
+        void map(const T *values, size_t count, Color32 *out) const
+        {
+            CPPUTILS_TRACE_ZONE("Gradient::map");
+            if constexpr (std::is_same_v<T, float>) {
+                detail::pixelKernels().lookup(values, count, _min, _scale, _packed.data(), _packed.size(), out);
+            } else {
+                const Color32 *lut = _packed.data();
+                for (size_t i = 0; i < count; i++)
+                    out[i] = lut[index(values[i])];
+            }
+        }
+
+        static Gradient viridis(size_t size = 256)
+        {
+            return fromHex({"440154", "472D7B", "3B528B", "2C728E", "21908C", "27AD81", "5DC863", "AADC32", "FDE725"}, size);
+        }
+
+        static Gradient magma(size_t size = 256)
+        {
+            return fromHex({"000004", "1D1147", "51127C", "822681", "B63679", "E65164", "FB8861", "FEC287", "FCFDBF"}, size);
+        }
+
+        // Polynomial fit of Google's Turbo colormap, sampled into stops
+        static Gradient turbo(size_t size = 256)
+        {
+            constexpr size_t count = 64;
+            std::vector<Stop> stops;
+            stops.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                T x = T(i) / T(count - 1);
+                T x2 = x * x;
+                T x3 = x2 * x;
+                T x4 = x2 * x2;
+                T x5 = x4 * x;
+                T r = T(0.13572138) + T(4.61539260) * x - T(42.66032258) * x2 + T(132.13108234) * x3
+                    - T(152.94239396) * x4 + T(59.28637943) * x5;
+                T g = T(0.09140261) + T(2.19418839) * x + T(4.84296658) * x2 - T(14.18503333) * x3
+                    + T(4.27729857) * x4 + T(2.82956604) * x5;
+                T b = T(0.10667330) + T(12.64194608) * x - T(60.58204836) * x2 + T(110.36276771) * x3
+                    - T(89.90310912) * x4 + T(27.34824973) * x5;
+                stops.push_back(Stop{x, Color<T>(r, g, b, 1).clamp()});
+            }
+            return Gradient(stops, size);
+        }
+
+    private:
+        static Gradient fromHex(std::initializer_list<std::string_view> colors, size_t size)
+        {
+            std::vector<Stop> stops;
+            stops.reserve(colors.size());
+            for (std::string_view hex : colors) {
+                Color3<T> color;
+                color.fromHex(hex);
+                stops.push_back(Stop{T(stops.size()) / T(colors.size() - 1), Color<T>(color, 1)});
+            }
+            return Gradient(stops, size);
+        }
+
+        static Color<T> cubic(const Color<T> &p0, const Color<T> &p1, const Color<T> &p2, const Color<T> &p3, T t)
+        {
+            T t2 = t * t;
+            T t3 = t2 * t;
+            return p0 * ((-t3 + 2 * t2 - t) / 2)
+                + p1 * ((3 * t3 - 5 * t2 + 2) / 2)
+                + p2 * ((-3 * t3 + 4 * t2 + t) / 2)
+                + p3 * ((t3 - t2) / 2);
+        }
+
+        void bake(size_t size)
+        {
+            T first = _stops.front().position;
+            T last = _stops.back().position;
+            _lut.resize(size);
+            _packed.resize(size);
+            for (size_t i = 0; i < size; i++) {
+                T position = first + (last - first) * T(i) / T(size - 1);
+                _lut[i] = sample(position);
+                _packed[i] = Color32::fromColor(_lut[i]);
+            }
+            if (!_customRange && last > first) {
+                _min = first;
+                _max = last;
+            }
+            updateScale();
+        }
+
+        void updateScale()
+        {
+            _scale = T(_lut.size() - 1) / (_max - _min);
+        }
+
+        // NaN and out-of-range values clamp to the ends of the table
+        size_t index(T value) const
+        {
+            return detail::lutIndex(value, _min, _scale, T(_lut.size() - 1));
+        }
+
+        std::vector<Stop> _stops;
+        std::vector<Color<T>> _lut;
+        std::vector<Color32> _packed;
+        Interpolation _mode = Interpolation::Linear;
+        T _min = 0;
+        T _max = 1;
+        T _scale = 0;
+        bool _customRange = false;
+    };
+
+    using Gradient4f = Gradient<float>;
+    using Gradient4d = Gradient<double>;
+
+} // namespace cpputils
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "Color.hpp"
+
+namespace cpputils {
+
+    // Four integer channels packed into one word: R in the lowest bits, then
+    // G, B and A. The layout is defined by shifts, not by memory order, so the
+    // packed value is the same on every platform.
+    //
+    // Arithmetic is exact: every product is divided by the channel maximum with
+    // rounding, using the (t + (t >> bits)) >> bits trick instead of a divide.
+    // R/B and G/A are processed as two lanes of one word (SWAR) wherever all
+    // channels share the same factor.
+    template <typename Word, typename Channel>
+    struct PackedColor {
+        static_assert(std::is_unsigned_v<Word> && std::is_unsigned_v<Channel>, "PackedColor needs unsigned types");
+        static_assert(sizeof(Word) == 4 * sizeof(Channel), "Word must hold exactly four channels");
+
+        static constexpr int bits = sizeof(Channel) * 8;
+        static constexpr Word max = (Word(1) << bits) - 1;
+        static constexpr Word laneMask = max | max << (2 * bits);
+        static constexpr Word laneHalf = (Word(1) << (bits - 1)) | (Word(1) << (3 * bits - 1));
+
+        Word value = 0;
+
+        PackedColor() = default;
+        explicit PackedColor(Word value)
+            : value(value)
+        {
+        }
+        PackedColor(Channel r, Channel g, Channel b, Channel a = Channel(max))
+            : value(Word(r) | Word(g) << bits | Word(b) << (2 * bits) | Word(a) << (3 * bits))
+        {
+        }
+
+        Channel r() const { return Channel(value); }
+        Channel g() const { return Channel(value >> bits); }
+        Channel b() const { return Channel(value >> (2 * bits)); }
+        Channel a() const { return Channel(value >> (3 * bits)); }
+
+        // Channels in R, G, B, A order
+        void fromChannels(const Channel *data)
+        {
+            *this = PackedColor(data[0], data[1], data[2], data[3]);
+        }
+
+        void toChannels(Channel *data) const
+        {
+            data[0] = r();
+            data[1] = g();
+            data[2] = b();
+            data[3] = a();
+        }
+
+        template <typename T>
+        static PackedColor fromColor(const Color<T> &color)
+        {
+            return PackedColor(quantize(color.color.r), quantize(color.color.g), quantize(color.color.b),
+                quantize(color.opacity));
+        }
+
+        template <typename T>
+        static PackedColor fromColor(const Color3<T> &color)
+        {
+            return PackedColor(quantize(color.r), quantize(color.g), quantize(color.b));
+        }
+
+        template <typename T>
+        Color<T> toColor() const
+        {
+            return Color<T>(T(r()) / T(max), T(g()) / T(max), T(b()) / T(max), T(a()) / T(max));
+        }
+
+        // round(a * b / max) for a, b <= max
+        static Word mulDiv(Word a, Word b)
+        {
+            Word t = a * b + (Word(1) << (bits - 1));
+            return (t + (t >> bits)) >> bits;
+        }
+
+        // All four channels multiplied by factor / max
+        PackedColor scale(Channel factor) const
+        {
+            Word rb = divLanes((value & laneMask) * factor);
+            Word ga = divLanes((value >> bits & laneMask) * factor);
+            return PackedColor(rb | ga << bits);
+        }
+
+        // Channel-wise product, each channel divided by max
+        PackedColor operator*(const PackedColor &other) const
+        {
+            return PackedColor(Channel(mulDiv(r(), other.r())), Channel(mulDiv(g(), other.g())),
+                Channel(mulDiv(b(), other.b())), Channel(mulDiv(a(), other.a())));
+        }
+
+        // this * (max - t) / max + other * t / max, rounded once
+        PackedColor lerp(const PackedColor &other, Channel t) const
+        {
+            Word s = max - t;
+            Word rb = divLanes((value & laneMask) * s + (other.value & laneMask) * t);
+            Word ga = divLanes((value >> bits & laneMask) * s + (other.value >> bits & laneMask) * t);
+            return PackedColor(rb | ga << bits);
+        }
+
+        PackedColor premultiply() const
+        {
+            Word alpha = a();
+            PackedColor scaled = scale(Channel(alpha));
+            return PackedColor((scaled.value & ~(max << (3 * bits))) | alpha << (3 * bits));
+        }
+
+        PackedColor unpremultiply() const
+        {
+            Word alpha = a();
+            if (alpha == 0)
+                return PackedColor(0, 0, 0, 0);
+            auto channel = [alpha](Word c) {
+                return Channel(std::min<Word>((c * max + alpha / 2) / alpha, max));
+            };
+            return PackedColor(channel(r()), channel(g()), channel(b()), Channel(alpha));
+        }
+
+        // Porter-Duff source-over on premultiplied colors: this + dst * (1 - a)
+        PackedColor over(const PackedColor &dst) const
+        {
+            return PackedColor(value + dst.scale(Channel(max - a())).value);
+        }
+
+        // Straight-alpha blend with the same semantics as Color::blend
+        void blend(const PackedColor &bg)
+        {
+            Word srcAlpha = a();
+            Word dstAlpha = mulDiv(bg.a(), max - srcAlpha);
+            Word outAlpha = srcAlpha + dstAlpha;
+
+            if (outAlpha > 0) {
+                auto channel = [&](Word src, Word dst) {
+                    return Channel((src * srcAlpha + dst * dstAlpha + outAlpha / 2) / outAlpha);
+                };
+                *this = PackedColor(channel(r(), bg.r()), channel(g(), bg.g()), channel(b(), bg.b()), Channel(outAlpha));
+            } else {
+                *this = PackedColor(r(), g(), b(), Channel(outAlpha));
+            }
+        }
+
+        bool operator==(const PackedColor &other) const
+        {
+            return value == other.value;
+        }
+
+        bool operator!=(const PackedColor &other) const
+        {
+            return value != other.value;
+        }
+
+    private:
+        template <typename T>
+        static Channel quantize(T value)
+        {
+            return Channel(std::clamp(value, T(0), T(1)) * T(max) + T(0.5));
+        }
+
+        // Rounded division by max of two lanes holding values <= max * max
+        static Word divLanes(Word lanes)
+        {
+            Word t = lanes + laneHalf;
+            return (t + (t >> bits & laneMask)) >> bits & laneMask;
+        }
+    };
+
+    using Color32 = PackedColor<u_int32_t, u_int8_t>;
+    using Color64 = PackedColor<u_int64_t, u_int16_t>;
+
+} // namespace cpputils
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "Color.hpp"
+#include "Trace.hpp"
+
+namespace cpputils {
+
+    template <typename T>
+    class Palette {
+    public:
+        Palette() = default;
+        Palette(const std::vector<Color3<T>> &colors)
+        {
+            setColors(colors);
+        }
+        ~Palette() = default;
+
+        void setColors(const std::vector<Color3<T>> &colors)
+        {
+            if (colors.size() > std::numeric_limits<u_int32_t>::max())
+                throw std::invalid_argument("Palette is too large");
+            _colors = colors;
+            _nodes.clear();
+            _nodes.reserve(_colors.size());
+            for (size_t i = 0; i < _colors.size(); i++)
+                _nodes.push_back(Node{_colors[i], static_cast<u_int32_t>(i), 0});
+            build(0, _nodes.size());
+        }
+
+        const std::vector<Color3<T>> &colors() const
+        {
+            return _colors;
+        }
+
+        size_t size() const
+        {
+            return _colors.size();
+        }
+
+        const Color3<T> &operator[](size_t index) const
+        {
+            return _colors[index];
+        }
+
+        // Index of the palette entry closest to color (squared RGB distance)
+        u_int32_t nearest(const Color3<T> &color) const
+        {
+            if (_nodes.empty())
+                throw std::runtime_error("Cannot search an empty palette");
+            u_int32_t best = 0;
+            T bestDist = std::numeric_limits<T>::max();
+            search(color, 0, _nodes.size(), best, bestDist);
+            return best;
+        }
+
+        void map(const Color3<T> *pixels, size_t count, u_int32_t *indices) const
+        {
+            CPPUTILS_TRACE_ZONE("Palette::map");
+            for (size_t i = 0; i < count; i++)
+                indices[i] = nearest(pixels[i]);
+        }
+
+        // Builds a palette of at most maxColors entries by median cut
+        static Palette medianCut(const Color3<T> *pixels, size_t count, size_t maxColors)
+        {
+            if (maxColors == 0)
+                throw std::invalid_argument("Palette needs at least one color");
+            std::vector<Color3<T>> work(pixels, pixels + count);
+            std::vector<Box> boxes;
+            if (!work.empty())
+                boxes.push_back(makeBox(work, 0, work.size()));
+            while (boxes.size() < maxColors) {
+                size_t pick = boxes.size();
+                T widest = 0;
+                for (size_t i = 0; i < boxes.size(); i++) {
+                    if (boxes[i].end - boxes[i].begin > 1 && boxes[i].range > widest) {
+                        widest = boxes[i].range;
+                        pick = i;
+                    }
+                }
+                if (pick == boxes.size())
+                    break;
+                Box box = boxes[pick];
+                size_t mid = box.begin + (box.end - box.begin) / 2;
+                int axis = box.axis;
+                std::nth_element(work.begin() + box.begin, work.begin() + mid, work.begin() + box.end,
+                    [axis](const Color3<T> &a, const Color3<T> &b) {
+                        return channel(a, axis) < channel(b, axis);
+                    });
+                boxes[pick] = makeBox(work, box.begin, mid);
+                boxes.push_back(makeBox(work, mid, box.end));
+            }
+            std::vector<Color3<T>> colors;
+            colors.reserve(boxes.size());
+            for (const Box &box : boxes) {
+                Color3<T> sum;
+                for (size_t i = box.begin; i < box.end; i++)
+                    sum += work[i];
+                sum /= static_cast<float>(box.end - box.begin);
+                colors.push_back(sum);
+            }
+            return Palette(colors);
+        }
+
+        // Floyd-Steinberg error diffusion. Rows are handed out round-robin to
+        // the worker threads; a row only advances while the row above is at
+        // least three pixels ahead, so rows run as a wavefront in parallel.
+        void dither(const Color3<T> *pixels, size_t width, size_t height, u_int32_t *indices,
+            unsigned threads = std::thread::hardware_concurrency()) const
+        {
+            if (width == 0 || height == 0)
+                return;
+            std::vector<Color3<T>> work(pixels, pixels + width * height);
+            std::vector<std::atomic<size_t>> progress(height);
+            for (auto &done : progress)
+                done.store(0, std::memory_order_relaxed);
+
+            auto ditherRow = [&](size_t y) {
+                Color3<T> *row = work.data() + y * width;
+                Color3<T> *below = y + 1 < height ? row + width : nullptr;
+                for (size_t x = 0; x < width; x++) {
+                    if (y > 0) {
+                        size_t needed = std::min(width, x + 3);
+                        while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                            std::this_thread::yield();
+                    }
+                    Color3<T> value = clamp(row[x]);
+                    u_int32_t index = nearest(value);
+                    indices[y * width + x] = index;
+                    Color3<T> error = value - _colors[index];
+                    if (x + 1 < width)
+                        row[x + 1] += error * (7.0f / 16.0f);
+                    if (below) {
+                        if (x > 0)
+                            below[x - 1] += error * (3.0f / 16.0f);
+                        below[x] += error * (5.0f / 16.0f);
+                        if (x + 1 < width)
+                            below[x + 1] += error * (1.0f / 16.0f);
+                    }
+                    progress[y].store(x + 1, std::memory_order_release);
+                }
+            };
+
+            threads = std::max(1u, std::min<unsigned>(threads, height));
+            if (threads == 1) {
+                for (size_t y = 0; y < height; y++)
+                    ditherRow(y);
+                return;
+            }
+            std::vector<std::thread> workers;
+            workers.reserve(threads);
+            for (unsigned t = 0; t < threads; t++) {
+                workers.emplace_back([&, t]() {
+                    for (size_t y = t; y < height; y += threads)
+                        ditherRow(y);
+                });
+            }
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+    private:
+        struct Node {
+            Color3<T> color;
+            u_int32_t index;
+            int axis;
+        };
+
+        struct Box {
+            size_t begin;
+            size_t end;
+            int axis;
+            T range;
+        };
+
+        static T channel(const Color3<T> &color, int axis)
+        {
+            return axis == 0 ? color.r : axis == 1 ? color.g : color.b;
+        }
+
+        static Color3<T> clamp(const Color3<T> &color)
+        {
+            return Color3<T>(
+                std::clamp(color.r, T(0), T(1)),
+                std::clamp(color.g, T(0), T(1)),
+                std::clamp(color.b, T(0), T(1)));
+        }
+
+        static T distance(const Color3<T> &a, const Color3<T> &b)
+        {
+            T dr = a.r - b.r;
+            T dg = a.g - b.g;
+            T db = a.b - b.b;
+            return dr * dr + dg * dg + db * db;
+        }
+
+        static int widestAxis(const Color3<T> *colors, size_t count, T &range)
+        {
+            Color3<T> lo = colors[0];
+            Color3<T> hi = colors[0];
+            for (size_t i = 1; i < count; i++) {
+                lo = Color3<T>(std::min(lo.r, colors[i].r), std::min(lo.g, colors[i].g), std::min(lo.b, colors[i].b));
+                hi = Color3<T>(std::max(hi.r, colors[i].r), std::max(hi.g, colors[i].g), std::max(hi.b, colors[i].b));
+            }
+            Color3<T> spread = hi - lo;
+            int axis = 0;
+            range = spread.r;
+            if (spread.g > range) {
+                axis = 1;
+                range = spread.g;
+            }
+            if (spread.b > range) {
+                axis = 2;
+                range = spread.b;
+            }
+            return axis;
+        }
+
+        static Box makeBox(const std::vector<Color3<T>> &colors, size_t begin, size_t end)
+        {
+            Box box{begin, end, 0, 0};
+            box.axis = widestAxis(colors.data() + begin, end - begin, box.range);
+            return box;
+        }
+
+        // Implicit k-d tree: the node of [begin, end) sits at the midpoint,
+        // its children cover [begin, mid) and [mid + 1, end).
+        void build(size_t begin, size_t end)
+        {
+            if (end - begin <= 1)
+                return;
+            std::vector<Color3<T>> colors;
+            colors.reserve(end - begin);
+            for (size_t i = begin; i < end; i++)
+                colors.push_back(_nodes[i].color);
+            T range;
+            int axis = widestAxis(colors.data(), colors.size(), range);
+            size_t mid = begin + (end - begin) / 2;
+            std::nth_element(_nodes.begin() + begin, _nodes.begin() + mid, _nodes.begin() + end,
+                [axis](const Node &a, const Node &b) {
+                    return channel(a.color, axis) < channel(b.color, axis);
+                });
+            _nodes[mid].axis = axis;
+            build(begin, mid);
+            build(mid + 1, end);
+        }
+
+        void search(const Color3<T> &color, size_t begin, size_t end, u_int32_t &best, T &bestDist) const
+        {
+            if (begin >= end)
+                return;
+            size_t mid = begin + (end - begin) / 2;
+            const Node &node = _nodes[mid];
+            T dist = distance(color, node.color);
+            if (dist < bestDist || (dist == bestDist && node.index < best)) {
+                bestDist = dist;
+                best = node.index;
+            }
+            T delta = channel(color, node.axis) - channel(node.color, node.axis);
+            if (delta < 0) {
+                search(color, begin, mid, best, bestDist);
+                if (delta * delta <= bestDist)
+                    search(color, mid + 1, end, best, bestDist);
+            } else {
+                search(color, mid + 1, end, best, bestDist);
+                if (delta * delta <= bestDist)
+                    search(color, begin, mid, best, bestDist);
+            }
+        }
+
+        std::vector<Color3<T>> _colors;
+        std::vector<Node> _nodes;
+    };
+
+    using Palette3f = Palette<float>;
+    using Palette3d = Palette<double>;
+
+} // namespace cpputils
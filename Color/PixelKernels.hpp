@@ -0,0 +1,473 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+#include "Color.hpp"
+#include "CpuFeatures.hpp"
+#include "PackedColor.hpp"
+#include "Trace.hpp"
+
+namespace cpputils {
+
+    namespace detail {
+
+        static_assert(sizeof(Color4f) == 4 * sizeof(float), "Color4f arrays are read as packed RGBA floats");
+        static_assert(sizeof(Color32) == 4, "Color32 arrays are read as packed RGBA bytes");
+
+        struct PixelKernels {
+            void (*blend)(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count);
+            void (*pack)(const Color4f *pixels, Color32 *out, size_t count);
+            void (*unpack)(const Color32 *pixels, Color4f *out, size_t count);
+            // out[i] = table[lutIndex(values[i], ...)] for tables of size entries
+            void (*lookup)(const float *values, size_t count, float min, float scale, const Color32 *table,
+                size_t size, Color32 *out);
+            void (*lookupColors)(const float *values, size_t count, float min, float scale, const Color4f *table,
+                size_t size, Color4f *out);
+        };
+
+CPPUTILS_FP_CONTRACT_OFF_BEGIN
+
+        inline void blendScalar(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++) {
+                Color4f color = fg[i];
+                color.blend(bg[i]);
+                out[i] = color;
+            }
+        }
+
+        inline void packScalar(const Color4f *pixels, Color32 *out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = Color32::fromColor(pixels[i]);
+        }
+
+        inline void unpackScalar(const Color32 *pixels, Color4f *out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = pixels[i].toColor<float>();
+        }
+
+        // Nearest entry of a table spanning [min, min + (size - 1) / scale];
+        // NaN and out-of-range values clamp to its ends
+        template <typename T>
+        inline size_t lutIndex(T value, T min, T scale, T last)
+        {
+            T t = (value - min) * scale + T(0.5);
+            t = t > 0 ? t : 0;
+            t = t < last ? t : last;
+            return static_cast<size_t>(t);
+        }
+
+        inline void lookupScalar(const float *values, size_t count, float min, float scale, const Color32 *table,
+            size_t size, Color32 *out)
+        {
+            float last = static_cast<float>(size - 1);
+            for (size_t i = 0; i < count; i++)
+                out[i] = table[lutIndex(values[i], min, scale, last)];
+        }
+
+        inline void lookupColorsScalar(const float *values, size_t count, float min, float scale,
+            const Color4f *table, size_t size, Color4f *out)
+        {
+            float last = static_cast<float>(size - 1);
+            for (size_t i = 0; i < count; i++)
+                out[i] = table[lutIndex(values[i], min, scale, last)];
+        }
+
+#ifdef CPPUTILS_X86
+        // One pixel per 128-bit lane; every step below stays inside its
+        // lane, so the wider versions run the same sequence on 2 or 4 pixels.
+        // Byte order in memory is R, G, B, A for both formats.
+
+        CPPUTILS_TARGET("sse2")
+        inline __m128 blendPixelSse2(__m128 fg, __m128 bg)
+        {
+            const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+            __m128 srcAlpha = _mm_shuffle_ps(fg, fg, _MM_SHUFFLE(3, 3, 3, 3));
+            __m128 dstAlpha = _mm_mul_ps(_mm_shuffle_ps(bg, bg, _MM_SHUFFLE(3, 3, 3, 3)), _mm_sub_ps(_mm_set1_ps(1.0f), srcAlpha));
+            __m128 outAlpha = _mm_add_ps(srcAlpha, dstAlpha);
+            __m128 mixed = _mm_div_ps(_mm_add_ps(_mm_mul_ps(fg, srcAlpha), _mm_mul_ps(bg, dstAlpha)), outAlpha);
+            // Keep the foreground color where the result is fully transparent
+            __m128 visible = _mm_cmpgt_ps(outAlpha, _mm_setzero_ps());
+            __m128 color = _mm_or_ps(_mm_and_ps(visible, mixed), _mm_andnot_ps(visible, fg));
+            return _mm_or_ps(_mm_and_ps(alphaLane, outAlpha), _mm_andnot_ps(alphaLane, color));
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void blendSse2(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count)
+        {
+            const float *src = reinterpret_cast<const float *>(fg);
+            const float *dst = reinterpret_cast<const float *>(bg);
+            float *result = reinterpret_cast<float *>(out);
+            for (size_t i = 0; i < count * 4; i += 4)
+                _mm_storeu_ps(result + i, blendPixelSse2(_mm_loadu_ps(src + i), _mm_loadu_ps(dst + i)));
+        }
+
+        // clamp(v, 0, 1) * 255 + 0.5, truncated, as PackedColor::fromColor
+        CPPUTILS_TARGET("sse2")
+        inline __m128i quantizeSse2(__m128 v)
+        {
+            v = _mm_max_ps(_mm_min_ps(v, _mm_set1_ps(1.0f)), _mm_setzero_ps());
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void packSse2(const Color4f *pixels, Color32 *out, size_t count)
+        {
+            const float *src = reinterpret_cast<const float *>(pixels);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4, src += 16) {
+                __m128i lo = _mm_packs_epi32(quantizeSse2(_mm_loadu_ps(src)), quantizeSse2(_mm_loadu_ps(src + 4)));
+                __m128i hi = _mm_packs_epi32(quantizeSse2(_mm_loadu_ps(src + 8)), quantizeSse2(_mm_loadu_ps(src + 12)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(lo, hi));
+            }
+            packScalar(pixels + i, out + i, count - i);
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void unpackSse2(const Color32 *pixels, Color4f *out, size_t count)
+        {
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128i zero = _mm_setzero_si128();
+            float *dst = reinterpret_cast<float *>(out);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4, dst += 16) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+                __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+                __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+                _mm_storeu_ps(dst, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+                _mm_storeu_ps(dst + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+                _mm_storeu_ps(dst + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+                _mm_storeu_ps(dst + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+            }
+            unpackScalar(pixels + i, out + i, count - i);
+        }
+
+        // lutIndex on four values; max and min return their second operand
+        // for NaN, as the comparisons in lutIndex do
+        CPPUTILS_TARGET("sse2")
+        inline __m128i lutIndicesSse2(__m128 values, __m128 min, __m128 scale, __m128 last)
+        {
+            __m128 t = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(values, min), scale), _mm_set1_ps(0.5f));
+            return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), last));
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void lookupSse2(const float *values, size_t count, float min, float scale, const Color32 *table,
+            size_t size, Color32 *out)
+        {
+            const __m128 vmin = _mm_set1_ps(min);
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 last = _mm_set1_ps(static_cast<float>(size - 1));
+            alignas(16) u_int32_t indices[4];
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_store_si128(reinterpret_cast<__m128i *>(indices), lutIndicesSse2(_mm_loadu_ps(values + i), vmin, vscale, last));
+                for (size_t j = 0; j < 4; j++)
+                    out[i + j] = table[indices[j]];
+            }
+            lookupScalar(values + i, count - i, min, scale, table, size, out + i);
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void lookupColorsSse2(const float *values, size_t count, float min, float scale,
+            const Color4f *table, size_t size, Color4f *out)
+        {
+            const __m128 vmin = _mm_set1_ps(min);
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 last = _mm_set1_ps(static_cast<float>(size - 1));
+            const float *entries = reinterpret_cast<const float *>(table);
+            float *dst = reinterpret_cast<float *>(out);
+            alignas(16) u_int32_t indices[4];
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_store_si128(reinterpret_cast<__m128i *>(indices), lutIndicesSse2(_mm_loadu_ps(values + i), vmin, vscale, last));
+                for (size_t j = 0; j < 4; j++)
+                    _mm_storeu_ps(dst + (i + j) * 4, _mm_loadu_ps(entries + indices[j] * 4));
+            }
+            lookupColorsScalar(values + i, count - i, min, scale, table, size, out + i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void blendAvx2(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count)
+        {
+            const __m256 alphaLanes = _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0));
+            const float *src = reinterpret_cast<const float *>(fg);
+            const float *dst = reinterpret_cast<const float *>(bg);
+            float *result = reinterpret_cast<float *>(out);
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2) {
+                __m256 f = _mm256_loadu_ps(src + i * 4);
+                __m256 b = _mm256_loadu_ps(dst + i * 4);
+                __m256 srcAlpha = _mm256_permute_ps(f, _MM_SHUFFLE(3, 3, 3, 3));
+                __m256 dstAlpha = _mm256_mul_ps(_mm256_permute_ps(b, _MM_SHUFFLE(3, 3, 3, 3)),
+                    _mm256_sub_ps(_mm256_set1_ps(1.0f), srcAlpha));
+                __m256 outAlpha = _mm256_add_ps(srcAlpha, dstAlpha);
+                __m256 mixed = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(f, srcAlpha), _mm256_mul_ps(b, dstAlpha)), outAlpha);
+                __m256 color = _mm256_blendv_ps(f, mixed, _mm256_cmp_ps(outAlpha, _mm256_setzero_ps(), _CMP_GT_OQ));
+                _mm256_storeu_ps(result + i * 4, _mm256_blendv_ps(color, outAlpha, alphaLanes));
+            }
+            blendSse2(fg + i, bg + i, out + i, count - i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline __m256i quantizeAvx2(__m256 v)
+        {
+            v = _mm256_max_ps(_mm256_min_ps(v, _mm256_set1_ps(1.0f)), _mm256_setzero_ps());
+            return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void packAvx2(const Color4f *pixels, Color32 *out, size_t count)
+        {
+            // The in-lane packs leave pixels in the order 0 2 4 6 1 3 5 7
+            const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            const float *src = reinterpret_cast<const float *>(pixels);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8, src += 32) {
+                __m256i lo = _mm256_packs_epi32(quantizeAvx2(_mm256_loadu_ps(src)), quantizeAvx2(_mm256_loadu_ps(src + 8)));
+                __m256i hi = _mm256_packs_epi32(quantizeAvx2(_mm256_loadu_ps(src + 16)), quantizeAvx2(_mm256_loadu_ps(src + 24)));
+                __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), bytes);
+            }
+            packSse2(pixels + i, out + i, count - i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void unpackAvx2(const Color32 *pixels, Color4f *out, size_t count)
+        {
+            const __m256 scale = _mm256_set1_ps(255.0f);
+            const u_int8_t *src = reinterpret_cast<const u_int8_t *>(pixels);
+            float *dst = reinterpret_cast<float *>(out);
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2) {
+                __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * 4));
+                _mm256_storeu_ps(dst + i * 4, _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), scale));
+            }
+            unpackScalar(pixels + i, out + i, count - i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline __m256i lutIndicesAvx2(__m256 values, __m256 min, __m256 scale, __m256 last)
+        {
+            __m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(values, min), scale), _mm256_set1_ps(0.5f));
+            return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), last));
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void lookupAvx2(const float *values, size_t count, float min, float scale, const Color32 *table,
+            size_t size, Color32 *out)
+        {
+            const __m256 vmin = _mm256_set1_ps(min);
+            const __m256 vscale = _mm256_set1_ps(scale);
+            const __m256 last = _mm256_set1_ps(static_cast<float>(size - 1));
+            const int *entries = reinterpret_cast<const int *>(table);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i indices = lutIndicesAvx2(_mm256_loadu_ps(values + i), vmin, vscale, last);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_i32gather_epi32(entries, indices, 4));
+            }
+            lookupSse2(values + i, count - i, min, scale, table, size, out + i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void lookupColorsAvx2(const float *values, size_t count, float min, float scale,
+            const Color4f *table, size_t size, Color4f *out)
+        {
+            const __m256 vmin = _mm256_set1_ps(min);
+            const __m256 vscale = _mm256_set1_ps(scale);
+            const __m256 last = _mm256_set1_ps(static_cast<float>(size - 1));
+            const float *entries = reinterpret_cast<const float *>(table);
+            float *dst = reinterpret_cast<float *>(out);
+            alignas(32) u_int32_t indices[8];
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_store_si256(reinterpret_cast<__m256i *>(indices),
+                    lutIndicesAvx2(_mm256_loadu_ps(values + i), vmin, vscale, last));
+                for (size_t j = 0; j < 8; j += 2) {
+                    __m256 pair = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(entries + indices[j] * 4)),
+                        _mm_loadu_ps(entries + indices[j + 1] * 4), 1);
+                    _mm256_storeu_ps(dst + (i + j) * 4, pair);
+                }
+            }
+            lookupColorsSse2(values + i, count - i, min, scale, table, size, out + i);
+        }
+
+        // Silences false positives from inside GCC 12's avx512fintrin.h
+#if defined(__GNUC__) && !defined(__clang__)
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+        // AVX-512 implies FMA. Adds with an explicit rounding mode are never
+        // contracted and the tails are masked rather than handed to inlined
+        // scalar code, so these kernels match blendScalar and packScalar
+        // even on compilers where the fp-contract region above has no effect.
+        constexpr int roundNearest = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+        CPPUTILS_TARGET("avx512f")
+        inline __m512 blendPixelsAvx512(__m512 fg, __m512 bg)
+        {
+            const __mmask16 alphaLanes = 0x8888;
+            __m512 srcAlpha = _mm512_permute_ps(fg, _MM_SHUFFLE(3, 3, 3, 3));
+            __m512 dstAlpha = _mm512_mul_ps(_mm512_permute_ps(bg, _MM_SHUFFLE(3, 3, 3, 3)),
+                _mm512_sub_ps(_mm512_set1_ps(1.0f), srcAlpha));
+            __m512 outAlpha = _mm512_add_round_ps(srcAlpha, dstAlpha, roundNearest);
+            __m512 mixed = _mm512_div_ps(_mm512_add_round_ps(_mm512_mul_ps(fg, srcAlpha), _mm512_mul_ps(bg, dstAlpha),
+                roundNearest), outAlpha);
+            __mmask16 visible = _mm512_cmp_ps_mask(outAlpha, _mm512_setzero_ps(), _CMP_GT_OQ);
+            return _mm512_mask_blend_ps(alphaLanes, _mm512_mask_blend_ps(visible, fg, mixed), outAlpha);
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void blendAvx512(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count)
+        {
+            const float *src = reinterpret_cast<const float *>(fg);
+            const float *dst = reinterpret_cast<const float *>(bg);
+            float *result = reinterpret_cast<float *>(out);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+                _mm512_storeu_ps(result + i * 4, blendPixelsAvx512(_mm512_loadu_ps(src + i * 4), _mm512_loadu_ps(dst + i * 4)));
+            if (i < count) {
+                __mmask16 mask = firstLanes((count - i) * 4);
+                _mm512_mask_storeu_ps(result + i * 4, mask, blendPixelsAvx512(_mm512_maskz_loadu_ps(mask, src + i * 4),
+                    _mm512_maskz_loadu_ps(mask, dst + i * 4)));
+            }
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline __m512i quantizeAvx512(__m512 v)
+        {
+            v = _mm512_max_ps(_mm512_min_ps(v, _mm512_set1_ps(1.0f)), _mm512_setzero_ps());
+            return _mm512_cvttps_epi32(_mm512_add_round_ps(_mm512_mul_ps(v, _mm512_set1_ps(255.0f)),
+                _mm512_set1_ps(0.5f), roundNearest));
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void packAvx512(const Color4f *pixels, Color32 *out, size_t count)
+        {
+            const float *src = reinterpret_cast<const float *>(pixels);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm512_cvtusepi32_epi8(quantizeAvx512(_mm512_loadu_ps(src + i * 4))));
+            if (i < count) {
+                __mmask16 mask = firstLanes((count - i) * 4);
+                _mm512_mask_cvtusepi32_storeu_epi8(out + i, mask, quantizeAvx512(_mm512_maskz_loadu_ps(mask, src + i * 4)));
+            }
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void unpackAvx512(const Color32 *pixels, Color4f *out, size_t count)
+        {
+            const __m512 scale = _mm512_set1_ps(255.0f);
+            float *dst = reinterpret_cast<float *>(out);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+                _mm512_storeu_ps(dst + i * 4, _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes)), scale));
+            }
+            if (i < count) {
+                __m128i bytes = _mm512_castsi512_si128(_mm512_maskz_loadu_epi32(firstLanes(count - i), pixels + i));
+                _mm512_mask_storeu_ps(dst + i * 4, firstLanes((count - i) * 4),
+                    _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes)), scale));
+            }
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline __m512i lutIndicesAvx512(__m512 values, __m512 min, __m512 scale, __m512 last)
+        {
+            __m512 t = _mm512_add_round_ps(_mm512_mul_ps(_mm512_sub_ps(values, min), scale), _mm512_set1_ps(0.5f),
+                roundNearest);
+            return _mm512_cvttps_epi32(_mm512_min_ps(_mm512_max_ps(t, _mm512_setzero_ps()), last));
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void lookupAvx512(const float *values, size_t count, float min, float scale, const Color32 *table,
+            size_t size, Color32 *out)
+        {
+            const __m512 vmin = _mm512_set1_ps(min);
+            const __m512 vscale = _mm512_set1_ps(scale);
+            const __m512 last = _mm512_set1_ps(static_cast<float>(size - 1));
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m512i indices = lutIndicesAvx512(_mm512_loadu_ps(values + i), vmin, vscale, last);
+                _mm512_storeu_si512(out + i, _mm512_i32gather_epi32(indices, table, 4));
+            }
+            if (i < count) {
+                __mmask16 mask = firstLanes(count - i);
+                __m512i indices = lutIndicesAvx512(_mm512_maskz_loadu_ps(mask, values + i), vmin, vscale, last);
+                _mm512_mask_storeu_epi32(out + i, mask,
+                    _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), mask, indices, table, 4));
+            }
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void lookupColorsAvx512(const float *values, size_t count, float min, float scale,
+            const Color4f *table, size_t size, Color4f *out)
+        {
+            const __m512 vmin = _mm512_set1_ps(min);
+            const __m512 vscale = _mm512_set1_ps(scale);
+            const __m512 last = _mm512_set1_ps(static_cast<float>(size - 1));
+            const float *entries = reinterpret_cast<const float *>(table);
+            float *dst = reinterpret_cast<float *>(out);
+            alignas(64) u_int32_t indices[16];
+            for (size_t i = 0; i < count; i += 16) {
+                size_t n = count - i < 16 ? count - i : 16;
+                __m512 chunk = _mm512_maskz_loadu_ps(firstLanes(n), values + i);
+                _mm512_store_si512(indices, lutIndicesAvx512(chunk, vmin, vscale, last));
+                for (size_t j = 0; j < n; j++)
+                    _mm_storeu_ps(dst + (i + j) * 4, _mm_loadu_ps(entries + indices[j] * 4));
+            }
+        }
+
+#if defined(__GNUC__) && !defined(__clang__)
+        #pragma GCC diagnostic pop
+#endif
+#endif
+
+CPPUTILS_FP_CONTRACT_OFF_END
+
+        inline const PixelKernels &pixelKernels()
+        {
+            static const PixelKernels tables[] = {
+                {blendScalar, packScalar, unpackScalar, lookupScalar, lookupColorsScalar},
+#ifdef CPPUTILS_X86
+                {blendSse2, packSse2, unpackSse2, lookupSse2, lookupColorsSse2},
+                {blendAvx2, packAvx2, unpackAvx2, lookupAvx2, lookupColorsAvx2},
+                {blendAvx512, packAvx512, unpackAvx512, lookupAvx512, lookupColorsAvx512},
+#endif
+            };
+            size_t level = static_cast<size_t>(simdLevel());
+            return tables[level < std::size(tables) ? level : 0];
+        }
+
+    } // namespace detail
+
+    // Bulk pixel operations, run with the widest instruction set the CPU
+    // supports (see simdLevel())
+
+    // out[i] = fg[i] blended over bg[i] with the formula of Color::blend;
+    // out may be fg or bg. Every SIMD level gives the same bits, which can
+    // differ in the last bit from Color::blend compiled with FMA contraction.
+    inline void blendPixels(const Color4f *fg, const Color4f *bg, Color4f *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("blendPixels");
+        detail::pixelKernels().blend(fg, bg, out, count);
+    }
+
+    // Clamped and rounded to 8 bits, as Color32::fromColor
+    inline void packPixels(const Color4f *pixels, Color32 *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("packPixels");
+        detail::pixelKernels().pack(pixels, out, count);
+    }
+
+    inline void unpackPixels(const Color32 *pixels, Color4f *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("unpackPixels");
+        detail::pixelKernels().unpack(pixels, out, count);
+    }
+
+} // namespace cpputils
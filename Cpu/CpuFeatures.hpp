@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define CPPUTILS_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// Compiles one function for an instruction set the rest of the program is
+// not built for; callers must check simdLevel() first
+#if defined(__GNUC__) || defined(__clang__)
+    #define CPPUTILS_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define CPPUTILS_TARGET(isa)
+#endif
+
+// Kernels between these markers are compiled without fusing multiplies and
+// adds into FMA, so every SIMD level rounds like the scalar kernel of the
+// same region whatever -march or -ffp-contract the program is built with.
+// Code outside the region, e.g. Color::blend or the Vector3 operators, may
+// still be contracted and can differ from the kernels in the last bit.
+#if defined(__clang__)
+    #define CPPUTILS_FP_CONTRACT_OFF_BEGIN _Pragma("float_control(push)") _Pragma("clang fp contract(off)")
+    #define CPPUTILS_FP_CONTRACT_OFF_END _Pragma("float_control(pop)")
+#elif defined(__GNUC__)
+    #define CPPUTILS_FP_CONTRACT_OFF_BEGIN _Pragma("GCC push_options") _Pragma("GCC optimize(\"fp-contract=off\")")
+    #define CPPUTILS_FP_CONTRACT_OFF_END _Pragma("GCC pop_options")
+#elif defined(_MSC_VER)
+    #define CPPUTILS_FP_CONTRACT_OFF_BEGIN __pragma(float_control(push)) __pragma(fp_contract(off))
+    #define CPPUTILS_FP_CONTRACT_OFF_END __pragma(float_control(pop))
+#else
+    #define CPPUTILS_FP_CONTRACT_OFF_BEGIN
+    #define CPPUTILS_FP_CONTRACT_OFF_END
+#endif
+
+namespace cpputils {
+
+    // Ordered: each level implies the ones before it
+    enum class SimdLevel {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    inline const char *toString(SimdLevel level)
+    {
+        switch (level) {
+        case SimdLevel::SSE2:
+            return "sse2";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+        }
+    }
+
+    inline SimdLevel simdLevelFromString(const std::string &name)
+    {
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (name == toString(level))
+                return level;
+        }
+        throw std::invalid_argument("Unknown SIMD level: " + name);
+    }
+
+    namespace detail {
+
+#ifdef CPPUTILS_X86
+        inline void cpuid(int leaf, int subleaf, unsigned int regs[4])
+        {
+#ifdef _MSC_VER
+            __cpuidex(reinterpret_cast<int *>(regs), leaf, subleaf);
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        }
+
+        // Register state the OS saves on context switches (XCR0)
+        inline unsigned long long xgetbv()
+        {
+#ifdef _MSC_VER
+            return _xgetbv(0);
+#else
+            unsigned int eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return static_cast<unsigned long long>(edx) << 32 | eax;
+#endif
+        }
+#endif
+
+        inline SimdLevel detectSimdLevel()
+        {
+            SimdLevel level = SimdLevel::Scalar;
+#ifdef CPPUTILS_X86
+            unsigned int regs[4];
+            cpuid(0, 0, regs);
+            unsigned int maxLeaf = regs[0];
+            cpuid(1, 0, regs);
+            if (!(regs[3] & (1u << 26)))
+                return level;
+            level = SimdLevel::SSE2;
+
+            bool osxsave = regs[2] & (1u << 27);
+            bool avx = regs[2] & (1u << 28);
+            if (!osxsave || !avx || maxLeaf < 7)
+                return level;
+            unsigned long long xcr0 = xgetbv();
+            cpuid(7, 0, regs);
+            // XMM and YMM state
+            if ((xcr0 & 0x6) == 0x6 && (regs[1] & (1u << 5)))
+                level = SimdLevel::AVX2;
+            // plus opmask and both halves of the ZMM state
+            if (level == SimdLevel::AVX2 && (xcr0 & 0xE0) == 0xE0 && (regs[1] & (1u << 16)))
+                level = SimdLevel::AVX512;
+#endif
+            return level;
+        }
+
+        // TSC that ticks at a constant rate in every P-, C- and T-state
+        // (CPUID 0x80000007 EDX bit 8)
+        inline bool detectInvariantTsc()
+        {
+#ifdef CPPUTILS_X86
+            unsigned int regs[4];
+            cpuid(0x80000000, 0, regs);
+            if (regs[0] < 0x80000007)
+                return false;
+            cpuid(0x80000007, 0, regs);
+            return regs[3] & (1u << 8);
+#else
+            return false;
+#endif
+        }
+
+#ifdef CPPUTILS_X86
+        // Mask of the first n lanes, n <= 16
+        inline __mmask16 firstLanes(size_t n)
+        {
+            return static_cast<__mmask16>((1u << n) - 1);
+        }
+#endif
+
+        // -1 while no override is set
+        inline std::atomic<int> &simdOverride()
+        {
+            static std::atomic<int> level{-1};
+            return level;
+        }
+
+    } // namespace detail
+
+    // Highest level this CPU and OS support, detected on first use.
+    // CPPUTILS_SIMD=scalar|sse2|avx2|avx512 in the environment lowers it,
+    // e.g. to compare code paths without rebuilding.
+    inline SimdLevel cpuSimdLevel()
+    {
+        static const SimdLevel level = []() {
+            SimdLevel detected = detail::detectSimdLevel();
+            const char *forced = std::getenv("CPPUTILS_SIMD");
+            if (forced) {
+                try {
+                    detected = std::min(detected, simdLevelFromString(forced));
+                } catch (const std::invalid_argument &) {
+                }
+            }
+            return detected;
+        }();
+        return level;
+    }
+
+    // Whether the TSC can serve as a clock, detected on first use
+    inline bool hasInvariantTsc()
+    {
+        static const bool invariant = detail::detectInvariantTsc();
+        return invariant;
+    }
+
+    // Level the dispatched kernels use
+    inline SimdLevel simdLevel()
+    {
+        int forced = detail::simdOverride().load(std::memory_order_relaxed);
+        return forced < 0 ? cpuSimdLevel() : static_cast<SimdLevel>(forced);
+    }
+
+    // Forces the kernels onto one code path, for testing and benchmarking
+    inline void setSimdLevel(SimdLevel level)
+    {
+        if (level > cpuSimdLevel())
+            throw std::invalid_argument(std::string("SIMD level not supported by this CPU: ") + toString(level));
+        detail::simdOverride().store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    inline void resetSimdLevel()
+    {
+        detail::simdOverride().store(-1, std::memory_order_relaxed);
+    }
+
+} // namespace cpputils
@@ -3,12 +3,29 @@
 
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+
+#include "PluginAllocator.hpp"
+#include "Trace.hpp"
+
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+    #include <atomic>
+    #include "LoaderProfiler.hpp"
+#endif
 
 #ifdef _WIN32
     #include <windows.h>
 
     #define LIB_HANDLE HINSTANCE
     #define LIB_LOAD(path) LoadLibrary(path)
+    #define LIB_LOAD_NOW(path) LoadLibrary(path)
     #define LIB_GETSYM(handle, name) GetProcAddress(handle, name)
     #define LIB_CLOSE(handle) FreeLibrary(handle)
     #define LIB_ERROR() "Unknown error"
@@ -20,6 +37,7 @@
 
     #define LIB_HANDLE void *
     #define LIB_LOAD(path) dlopen(path, RTLD_LAZY)
+    #define LIB_LOAD_NOW(path) dlopen(path, RTLD_NOW)
     #define LIB_GETSYM(handle, name) dlsym(handle, name)
     #define LIB_CLOSE(handle) dlclose(handle)
     #define LIB_ERROR() dlerror()
@@ -32,50 +50,197 @@
 
 namespace cpputils {
 
+    // When the dynamic linker binds a library's function references
+    enum class BindPolicy {
+        Lazy,   // on first call (RTLD_LAZY)
+        Now     // all at load time (RTLD_NOW)
+    };
+
     template <typename T>
     class DLLoader {
     public:
-        DLLoader(const std::string &path, const std::string &name)
+        DLLoader(const std::string &path, const std::string &name, BindPolicy policy = BindPolicy::Lazy)
         {
-            load(path, name);
+            load(path, name, policy);
+        }
+        DLLoader(const std::string &path, const std::string &name, const std::vector<std::string> &symbols,
+            BindPolicy policy = BindPolicy::Lazy)
+        {
+            load(path, name, policy);
+            resolve(symbols);
         }
         DLLoader()
         {
         }
+        DLLoader(const DLLoader &) = delete;
+        DLLoader &operator=(const DLLoader &) = delete;
         ~DLLoader()
         {
             if (_handle)
                 LIB_CLOSE(_handle);
         }
 
-        void load(const std::string &path, const std::string &name)
+        // With instrumentation, stats are recorded under profileName, or
+        // under name when it is empty, so reloads of the same library
+        // through different files share one entry
+        void load(const std::string &path, const std::string &name, BindPolicy policy = BindPolicy::Lazy,
+            const std::string &profileName = "")
         {
+            CPPUTILS_TRACE_ZONE("DLLoader::load");
+            std::unique_lock<std::shared_mutex> lock(_mutex);
+            _symbols.clear();
+            _names.clear();
             if (_handle)
                 LIB_CLOSE(_handle);
-            std::string libPath = path + LIB_PREFIX + name + LIB_SUFFIX;
-            _handle = LIB_LOAD(libPath.c_str());
+            _path = path + LIB_PREFIX + name + LIB_SUFFIX;
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            _profileName = profileName.empty() ? name : profileName;
+            auto start = std::chrono::steady_clock::now();
+#endif
+            _handle = policy == BindPolicy::Now ? LIB_LOAD_NOW(_path.c_str()) : LIB_LOAD(_path.c_str());
             if (!_handle)
                 throw std::runtime_error("Cannot load library: " + std::string(path) + ": " + LIB_ERROR());
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            LoaderProfiler::instance().recordLoad(_profileName, detail::nanosecondsSince(start));
+#endif
+        }
+
+        // Resolves a whole symbol table up front, so later lookups never
+        // reach the dynamic linker. Throws on the first missing symbol.
+        void resolve(const std::vector<std::string> &symbols)
+        {
+            for (const std::string &symbol : symbols)
+                find(symbol.c_str());
+        }
+
+        // Typed function pointer, e.g. getSymbol<T *(int)>("create").
+        // The address is looked up once and cached in the loader.
+        template <typename Signature>
+        Signature *getSymbol(const char *name) const
+        {
+            static_assert(std::is_function_v<Signature>, "getSymbol expects a function type");
+            return reinterpret_cast<Signature *>(find(name).address);
+        }
+
+        template <typename Signature>
+        Signature *getSymbol(const std::string &name) const
+        {
+            return getSymbol<Signature>(name.c_str());
         }
 
         template <typename... Args>
-        T *getInstance(const char *name, Args... args) const
+        T *getInstance(const char *name, Args &&...args) const
         {
-            T *(*fptr)(Args...) = reinterpret_cast<T *(*)(Args...)>(LIB_GETSYM(_handle, name));
-            if (!fptr)
-                throw std::runtime_error("Cannot load symbol \"" + std::string(name) + "\": " + LIB_ERROR());
-            return fptr(args...);
+            return create<T *(std::decay_t<Args>...)>(name, std::forward<Args>(args)...);
         }
 
-        T *getInstance(const char *name) const
+        // Calls a factory of the form T *name(PluginAllocator *, Args...)
+        // and hands ownership back with a deleter that returns the memory to
+        // allocator, which must outlive the instance
+        template <typename... Args>
+        PluginPtr<T> getPooledInstance(const char *name, PluginAllocator &allocator, Args &&...args) const
         {
-            T *(*fptr)(void) = reinterpret_cast<T *(*)(void)>(LIB_GETSYM(_handle, name));
-            if (!fptr)
-                throw std::runtime_error("Cannot load symbol \"" + std::string(name) + "\": " + LIB_ERROR());
-            return fptr();
+            T *instance = create<T *(PluginAllocator *, std::decay_t<Args>...)>(name, &allocator,
+                std::forward<Args>(args)...);
+            if (!instance)
+                throw std::runtime_error("Factory \"" + std::string(name) + "\" could not allocate an instance");
+            return PluginPtr<T>(instance, PluginDeleter<T>{&allocator});
         }
+
     private:
+        struct Symbol {
+            void *address = nullptr;
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            mutable std::atomic<bool> called{false};
+#endif
+        };
+
+        // Copied out under the lock, since load() may clear the table as
+        // soon as it is released
+        struct Resolved {
+            void *address = nullptr;
+            bool firstCall = false;
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            // Set on the first call only
+            std::string profileName;
+#endif
+        };
+
+        // With markCalled, firstCall tells whether this is the first call
+        // of the symbol since it was resolved
+        Resolved find(const char *name, bool markCalled = false) const
+        {
+            {
+                std::shared_lock<std::shared_mutex> lock(_mutex);
+                auto it = _symbols.find(name);
+                if (it != _symbols.end())
+                    return resolved(it->second, markCalled);
+            }
+            std::unique_lock<std::shared_mutex> lock(_mutex);
+            if (!_handle)
+                throw std::runtime_error("Cannot load symbol \"" + std::string(name) + "\": no library loaded");
+            auto it = _symbols.find(name);
+            if (it != _symbols.end())
+                return resolved(it->second, markCalled);
+            CPPUTILS_TRACE_ZONE("DLLoader::resolveSymbol");
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            auto start = std::chrono::steady_clock::now();
+#endif
+            void *address = reinterpret_cast<void *>(LIB_GETSYM(_handle, name));
+            if (!address)
+                throw std::runtime_error("Cannot load symbol \"" + std::string(name) + "\": " + LIB_ERROR());
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            LoaderProfiler::instance().recordLookup(_profileName, name, detail::nanosecondsSince(start));
+#endif
+            Symbol &symbol = _symbols.try_emplace(_names.emplace_back(name)).first->second;
+            symbol.address = address;
+            return resolved(symbol, markCalled);
+        }
+
+        // Called with _mutex held
+        Resolved resolved(const Symbol &symbol, bool markCalled) const
+        {
+            Resolved result{symbol.address};
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            if (markCalled)
+                result.firstCall = !symbol.called.exchange(true, std::memory_order_relaxed);
+            if (result.firstCall)
+                result.profileName = _profileName;
+#else
+            (void)markCalled;
+#endif
+            return result;
+        }
+
+        // Calls the factory name; with instrumentation, the first call of
+        // each factory is timed
+        template <typename Factory, typename... Args>
+        T *create(const char *name, Args &&...args) const
+        {
+            static_assert(std::is_function_v<Factory>, "create expects a function type");
+            CPPUTILS_TRACE_ZONE("DLLoader::create");
+            Resolved symbol = find(name, true);
+            Factory *factory = reinterpret_cast<Factory *>(symbol.address);
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+            if (symbol.firstCall) {
+                auto start = std::chrono::steady_clock::now();
+                T *instance = factory(std::forward<Args>(args)...);
+                LoaderProfiler::instance().recordFirstCall(symbol.profileName, name, detail::nanosecondsSince(start));
+                return instance;
+            }
+#endif
+            return factory(std::forward<Args>(args)...);
+        }
+
         LIB_HANDLE _handle = 0;
+        std::string _path;
+#ifdef CPPUTILS_DLLOADER_INSTRUMENTATION
+        std::string _profileName;
+#endif
+        mutable std::shared_mutex _mutex;
+        // Keys point into _names, which never moves its strings
+        mutable std::unordered_map<std::string_view, Symbol> _symbols;
+        mutable std::deque<std::string> _names;
     };
 
 } // namespace cpputils
\ No newline at end of file
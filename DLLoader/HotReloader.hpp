@@ -0,0 +1,286 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/inotify.h>
+#else
+    #error "HotReloader needs inotify"
+#endif
+
+#include "DLLoader.hpp"
+
+namespace cpputils {
+
+    // Keeps a function table bound to the newest build of a library.
+    //
+    // Each reload copies the library to a fresh shadow file (dlopen would
+    // otherwise hand back the already loaded image for the same path), loads
+    // it, fills a new Table through the binder and publishes it with one
+    // atomic store. table() is a single acquire load.
+    //
+    // Old tables are retired with quiescent-state reclamation: every thread
+    // that calls table() registers a Reader and calls quiescent() at points
+    // where it holds no table references (e.g. once per frame). A retired
+    // library is closed once every live Reader has passed such a point; with
+    // no Reader registered it is kept until collect() is called.
+    //
+    // Shadow files are written next to the library, or to shadowDirectory
+    // when one is given, and removed again right after loading.
+    template <typename T, typename Table>
+    class HotReloader {
+    public:
+        using Binder = std::function<Table(DLLoader<T> &)>;
+
+        class Reader {
+        public:
+            Reader() = default;
+            Reader(Reader &&) = default;
+            Reader &operator=(Reader &&) = default;
+            ~Reader()
+            {
+                if (_state)
+                    _state->active.store(false, std::memory_order_release);
+            }
+
+            void quiescent()
+            {
+                if (!_state)
+                    return;
+                _state->seen.store(_epoch->load(std::memory_order_acquire), std::memory_order_release);
+            }
+
+        private:
+            friend class HotReloader;
+
+            struct State {
+                std::atomic<u_int64_t> seen{0};
+                std::atomic<bool> active{true};
+            };
+
+            std::shared_ptr<State> _state;
+            const std::atomic<u_int64_t> *_epoch = nullptr;
+        };
+
+        HotReloader(const std::string &path, const std::string &name, Binder binder, BindPolicy policy = BindPolicy::Now,
+            const std::string &shadowDirectory = "")
+            : _path(path), _name(name), _shadowDirectory(shadowDirectory), _binder(std::move(binder)), _policy(policy)
+        {
+            reload();
+        }
+        HotReloader(const HotReloader &) = delete;
+        HotReloader &operator=(const HotReloader &) = delete;
+        ~HotReloader()
+        {
+            stop();
+            delete _current.load();
+            for (auto &[_, generation] : _retired)
+                delete generation;
+        }
+
+        const Table &table() const
+        {
+            return _current.load(std::memory_order_acquire)->table;
+        }
+
+        // Number of successful reloads, including the initial load
+        u_int64_t generation() const
+        {
+            return _current.load(std::memory_order_acquire)->number;
+        }
+
+        Reader registerReader()
+        {
+            Reader reader;
+            reader._state = std::make_shared<typename Reader::State>();
+            reader._epoch = &_epoch;
+            reader.quiescent();
+            std::lock_guard<std::mutex> lock(_mutex);
+            _readers.push_back(reader._state);
+            return reader;
+        }
+
+        // Loads the current library file and publishes its table. On
+        // failure the previous table stays in place and the error is thrown.
+        void reload()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            u_int64_t number = _generations + 1;
+            std::filesystem::path source = std::filesystem::path(_path) / (LIB_PREFIX + _name + LIB_SUFFIX);
+            std::string shadowName = _name + "-" + std::to_string(::getpid()) + "-" + std::to_string(number);
+            std::filesystem::path shadowDir = _shadowDirectory.empty() ? source.parent_path() : std::filesystem::path(_shadowDirectory);
+            // dlopen only searches the library path for names without a slash
+            if (shadowDir.empty())
+                shadowDir = ".";
+            std::filesystem::path shadow = shadowDir / (LIB_PREFIX + shadowName + LIB_SUFFIX);
+
+            std::filesystem::copy_file(source, shadow, std::filesystem::copy_options::overwrite_existing);
+            auto generation = std::make_unique<Generation>();
+            try {
+                generation->loader.load((shadowDir / "").string(), shadowName, _policy, _name);
+                generation->table = _binder(generation->loader);
+            } catch (...) {
+                std::filesystem::remove(shadow);
+                throw;
+            }
+            // The mapping keeps the image alive; the file is no longer needed
+            std::filesystem::remove(shadow);
+            generation->number = number;
+            _generations = number;
+
+            const Generation *old = _current.exchange(generation.release());
+            if (old)
+                _retired.emplace_back(_epoch.fetch_add(1) + 1, old);
+            collectLocked(false);
+        }
+
+        // Closes retired libraries that no registered reader can still use.
+        // Without registered readers this closes every retired library, so
+        // the caller must hold no references into old tables.
+        void collect()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            collectLocked(true);
+        }
+
+        // Watches the library file with inotify and reloads after it has
+        // been rewritten and left alone for settle
+        void start(std::chrono::milliseconds settle = std::chrono::milliseconds(50))
+        {
+            if (_watcher.joinable())
+                return;
+            int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd < 0)
+                throw std::runtime_error("Cannot initialize inotify");
+            std::string directory = _path.empty() ? "." : _path;
+            if (::inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+                ::close(fd);
+                throw std::runtime_error("Cannot watch directory: " + directory);
+            }
+            _running.store(true);
+            _watcher = std::thread([this, fd, settle]() {
+                watch(fd, settle);
+                ::close(fd);
+            });
+        }
+
+        void stop()
+        {
+            _running.store(false);
+            if (_watcher.joinable())
+                _watcher.join();
+        }
+
+        // Message of the last failed automatic reload, empty if none
+        std::string lastError() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _lastError;
+        }
+
+    private:
+        struct Generation {
+            DLLoader<T> loader;
+            Table table;
+            u_int64_t number = 0;
+        };
+
+        // Without readers nothing proves an old table is unused, so only an
+        // explicit collect() may close retired libraries then
+        void collectLocked(bool explicitCall)
+        {
+            _readers.erase(std::remove_if(_readers.begin(), _readers.end(), [](const auto &reader) {
+                return !reader->active.load(std::memory_order_acquire);
+            }), _readers.end());
+            if (_readers.empty() && !explicitCall)
+                return;
+            u_int64_t oldest = _epoch.load();
+            for (const auto &reader : _readers)
+                oldest = std::min(oldest, reader->seen.load(std::memory_order_acquire));
+            auto end = std::remove_if(_retired.begin(), _retired.end(), [oldest](const auto &entry) {
+                if (entry.first > oldest)
+                    return false;
+                delete entry.second;
+                return true;
+            });
+            _retired.erase(end, _retired.end());
+        }
+
+        // Drains pending events; true if one of them touched our library
+        bool drain(int fd)
+        {
+            std::string file = LIB_PREFIX + _name + LIB_SUFFIX;
+            alignas(struct inotify_event) char buffer[4096];
+            bool touched = false;
+            ssize_t length;
+            while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char *ptr = buffer; ptr < buffer + length;) {
+                    auto *event = reinterpret_cast<struct inotify_event *>(ptr);
+                    if (event->len > 0 && file == event->name)
+                        touched = true;
+                    ptr += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            return touched;
+        }
+
+        void watch(int fd, std::chrono::milliseconds settle)
+        {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            bool dirty = false;
+            auto changed = std::chrono::steady_clock::now();
+            while (_running.load()) {
+                if (::poll(&pfd, 1, dirty ? static_cast<int>(settle.count()) : 100) > 0 && drain(fd)) {
+                    dirty = true;
+                    changed = std::chrono::steady_clock::now();
+                    continue;
+                }
+                if (dirty && std::chrono::steady_clock::now() - changed >= settle) {
+                    dirty = false;
+                    try {
+                        reload();
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _lastError.clear();
+                    } catch (const std::exception &e) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _lastError = e.what();
+                    }
+                }
+                std::lock_guard<std::mutex> lock(_mutex);
+                collectLocked(false);
+            }
+        }
+
+        std::string _path;
+        std::string _name;
+        std::string _shadowDirectory;
+        Binder _binder;
+        BindPolicy _policy;
+
+        std::atomic<const Generation *> _current{nullptr};
+        std::atomic<u_int64_t> _epoch{0};
+        std::vector<std::pair<u_int64_t, const Generation *>> _retired;
+        std::vector<std::shared_ptr<typename Reader::State>> _readers;
+        u_int64_t _generations = 0;
+
+        mutable std::mutex _mutex;
+        std::string _lastError;
+        std::thread _watcher;
+        std::atomic<bool> _running{false};
+    };
+
+} // namespace cpputils
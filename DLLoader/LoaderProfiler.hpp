@@ -0,0 +1,148 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+
+#include "JsonString.hpp"
+
+namespace cpputils {
+
+    namespace detail {
+
+        inline u_int64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    } // namespace detail
+
+    struct SymbolProfile {
+        std::string name;
+        u_int64_t lookupNs = 0;
+        // Time of the first call through getInstance, if there was one
+        bool called = false;
+        u_int64_t firstCallNs = 0;
+    };
+
+    // Keyed by the library name given to DLLoader::load, not by file path
+    struct LibraryProfile {
+        std::string name;
+        u_int64_t loads = 0;
+        u_int64_t loadNs = 0;
+        u_int64_t lookupNs = 0;
+        std::vector<SymbolProfile> symbols;
+    };
+
+    // Process-wide record of library loads. DLLoader only reports here when
+    // built with CPPUTILS_DLLOADER_INSTRUMENTATION; otherwise nothing is recorded.
+    class LoaderProfiler {
+    public:
+        static LoaderProfiler &instance()
+        {
+            static LoaderProfiler profiler;
+            return profiler;
+        }
+
+        void recordLoad(const std::string &name, u_int64_t nanoseconds)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            LibraryProfile &library = find(name);
+            library.loads++;
+            library.loadNs += nanoseconds;
+        }
+
+        void recordLookup(const std::string &name, const std::string &symbol, u_int64_t nanoseconds)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            LibraryProfile &library = find(name);
+            library.lookupNs += nanoseconds;
+            findSymbol(library, symbol).lookupNs += nanoseconds;
+        }
+
+        void recordFirstCall(const std::string &name, const std::string &symbol, u_int64_t nanoseconds)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            SymbolProfile &profile = findSymbol(find(name), symbol);
+            if (!profile.called) {
+                profile.called = true;
+                profile.firstCallNs = nanoseconds;
+            }
+        }
+
+        // Snapshot, ordered by library name
+        std::vector<LibraryProfile> libraries() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<LibraryProfile> result;
+            result.reserve(_libraries.size());
+            for (const auto &[_, library] : _libraries)
+                result.push_back(library);
+            return result;
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _libraries.clear();
+        }
+
+        void dumpJson(std::ostream &os) const
+        {
+            std::vector<LibraryProfile> snapshot = libraries();
+            u_int64_t totalNs = 0;
+            for (const LibraryProfile &library : snapshot)
+                totalNs += library.loadNs + library.lookupNs;
+            os << "{\"totalNs\":" << totalNs << ",\"libraries\":[";
+            for (size_t i = 0; i < snapshot.size(); i++) {
+                const LibraryProfile &library = snapshot[i];
+                os << (i ? "," : "") << "{\"name\":";
+                detail::writeJsonString(os, library.name);
+                os << ",\"loads\":" << library.loads << ",\"loadNs\":" << library.loadNs
+                    << ",\"symbolCount\":" << library.symbols.size() << ",\"lookupNs\":" << library.lookupNs
+                    << ",\"symbols\":[";
+                for (size_t j = 0; j < library.symbols.size(); j++) {
+                    const SymbolProfile &symbol = library.symbols[j];
+                    os << (j ? "," : "") << "{\"name\":";
+                    detail::writeJsonString(os, symbol.name);
+                    os << ",\"lookupNs\":" << symbol.lookupNs << ",\"firstCallNs\":";
+                    if (symbol.called)
+                        os << symbol.firstCallNs;
+                    else
+                        os << "null";
+                    os << "}";
+                }
+                os << "]}";
+            }
+            os << "]}";
+        }
+
+    private:
+        LoaderProfiler() = default;
+
+        LibraryProfile &find(const std::string &name)
+        {
+            LibraryProfile &library = _libraries[name];
+            library.name = name;
+            return library;
+        }
+
+        static SymbolProfile &findSymbol(LibraryProfile &library, const std::string &name)
+        {
+            for (SymbolProfile &symbol : library.symbols) {
+                if (symbol.name == name)
+                    return symbol;
+            }
+            library.symbols.push_back(SymbolProfile{name});
+            return library.symbols.back();
+        }
+
+        mutable std::mutex _mutex;
+        std::map<std::string, LibraryProfile> _libraries;
+    };
+
+} // namespace cpputils
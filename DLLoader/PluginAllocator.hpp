@@ -0,0 +1,180 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <type_traits>
+
+namespace cpputils {
+
+    // Allocator handed across the plugin boundary. It is a plain C struct so
+    // host and plugin only have to agree on this layout, not on their C++
+    // runtimes. Pooled factories have the signature
+    //     extern "C" T *create(cpputils::PluginAllocator *allocator, Args...);
+    // and build their object with pluginNew().
+    extern "C" {
+        struct PluginAllocator {
+            void *context;
+            void *(*allocate)(void *context, size_t size, size_t alignment);
+            void (*deallocate)(void *context, void *ptr);
+        };
+    }
+
+    // Plugin side: constructs Impl in memory from allocator. Returns nullptr
+    // when the allocator cannot serve the request.
+    template <typename Impl, typename... Args>
+    Impl *pluginNew(PluginAllocator *allocator, Args &&...args)
+    {
+        void *memory = allocator->allocate(allocator->context, sizeof(Impl), alignof(Impl));
+        if (!memory)
+            return nullptr;
+        try {
+            return new (memory) Impl(std::forward<Args>(args)...);
+        } catch (...) {
+            allocator->deallocate(allocator->context, memory);
+            throw;
+        }
+    }
+
+    // Host side: destroys through the virtual destructor and returns the
+    // memory of the most derived object to the allocator it came from
+    template <typename T>
+    struct PluginDeleter {
+        static_assert(std::has_virtual_destructor_v<T>, "Pooled plugin interfaces need a virtual destructor");
+
+        PluginAllocator *allocator = nullptr;
+
+        void operator()(T *ptr) const
+        {
+            if (!ptr)
+                return;
+            void *memory = dynamic_cast<void *>(ptr);
+            ptr->~T();
+            allocator->deallocate(allocator->context, memory);
+        }
+    };
+
+    template <typename T>
+    using PluginPtr = std::unique_ptr<T, PluginDeleter<T>>;
+
+    // General-purpose aligned heap allocation
+    class HeapPluginAllocator : public PluginAllocator {
+    public:
+        HeapPluginAllocator()
+            : PluginAllocator{this, &HeapPluginAllocator::allocateImpl, &HeapPluginAllocator::deallocateImpl}
+        {
+        }
+        HeapPluginAllocator(const HeapPluginAllocator &) = delete;
+        HeapPluginAllocator &operator=(const HeapPluginAllocator &) = delete;
+
+    private:
+        static void *allocateImpl(void *, size_t size, size_t alignment)
+        {
+            alignment = std::max(alignment, sizeof(void *));
+#ifdef _WIN32
+            return _aligned_malloc(size, alignment);
+#else
+            void *ptr = nullptr;
+            return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+#endif
+        }
+
+        static void deallocateImpl(void *, void *ptr)
+        {
+#ifdef _WIN32
+            _aligned_free(ptr);
+#else
+            free(ptr);
+#endif
+        }
+    };
+
+    // Fixed-size blocks carved out of larger chunks and recycled through a
+    // free list, so instance churn never reaches malloc once warmed up.
+    // Requests larger than the block size fail.
+    class PoolPluginAllocator : public PluginAllocator {
+    public:
+        PoolPluginAllocator(size_t blockSize, size_t blocksPerChunk = 64)
+            : PluginAllocator{this, &PoolPluginAllocator::allocateImpl, &PoolPluginAllocator::deallocateImpl},
+              _blockSize(roundUp(std::max(blockSize, sizeof(FreeBlock)))),
+              _blocksPerChunk(std::max<size_t>(blocksPerChunk, 1))
+        {
+        }
+        PoolPluginAllocator(const PoolPluginAllocator &) = delete;
+        PoolPluginAllocator &operator=(const PoolPluginAllocator &) = delete;
+        ~PoolPluginAllocator() = default;
+
+        size_t blockSize() const
+        {
+            return _blockSize;
+        }
+
+        size_t inUse() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _inUse;
+        }
+
+        size_t capacity() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _chunks.size() * _blocksPerChunk;
+        }
+
+    private:
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        static size_t roundUp(size_t size)
+        {
+            constexpr size_t align = alignof(std::max_align_t);
+            return (size + align - 1) / align * align;
+        }
+
+        static void *allocateImpl(void *context, size_t size, size_t alignment)
+        {
+            auto *pool = static_cast<PoolPluginAllocator *>(context);
+            if (size > pool->_blockSize || alignment > alignof(std::max_align_t))
+                return nullptr;
+            std::lock_guard<std::mutex> lock(pool->_mutex);
+            if (!pool->_free)
+                pool->grow();
+            FreeBlock *block = pool->_free;
+            pool->_free = block->next;
+            pool->_inUse++;
+            return block;
+        }
+
+        static void deallocateImpl(void *context, void *ptr)
+        {
+            auto *pool = static_cast<PoolPluginAllocator *>(context);
+            std::lock_guard<std::mutex> lock(pool->_mutex);
+            pool->_free = new (ptr) FreeBlock{pool->_free};
+            pool->_inUse--;
+        }
+
+        void grow()
+        {
+            size_t bytes = _blockSize * _blocksPerChunk;
+            std::unique_ptr<std::max_align_t[]> chunk(new std::max_align_t[(bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+            auto *memory = reinterpret_cast<unsigned char *>(chunk.get());
+            for (size_t i = _blocksPerChunk; i-- > 0;)
+                _free = new (memory + i * _blockSize) FreeBlock{_free};
+            _chunks.push_back(std::move(chunk));
+        }
+
+        size_t _blockSize;
+        size_t _blocksPerChunk;
+        mutable std::mutex _mutex;
+        FreeBlock *_free = nullptr;
+        size_t _inUse = 0;
+        std::vector<std::unique_ptr<std::max_align_t[]>> _chunks;
+    };
+
+} // namespace cpputils
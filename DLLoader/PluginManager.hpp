@@ -0,0 +1,186 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+#include "DLLoader.hpp"
+
+namespace cpputils {
+
+    struct PluginOptions {
+        // Defer dlopen until the first symbol of the plugin is requested
+        bool deferred = false;
+        BindPolicy bind = BindPolicy::Lazy;
+    };
+
+    // Set of DLLoader instances loaded from one or more directories.
+    // Register plugins with scan() or add() before loading or looking up
+    // symbols; lookups and deferred loads are then safe from any thread.
+    template <typename T>
+    class PluginManager {
+    public:
+        PluginManager(PluginOptions defaults = PluginOptions())
+            : _defaults(defaults)
+        {
+        }
+        PluginManager(const PluginManager &) = delete;
+        PluginManager &operator=(const PluginManager &) = delete;
+        ~PluginManager() = default;
+
+        // Registers every LIB_PREFIX<name>LIB_SUFFIX file in directory with
+        // the default options and returns the plugin names, sorted
+        std::vector<std::string> scan(const std::string &directory)
+        {
+            std::string prefix = LIB_PREFIX;
+            std::string suffix = LIB_SUFFIX;
+            std::vector<std::string> found;
+            for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+                if (!entry.is_regular_file())
+                    continue;
+                std::string file = entry.path().filename().string();
+                if (file.size() <= prefix.size() + suffix.size()
+                    || file.compare(0, prefix.size(), prefix) != 0
+                    || file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0)
+                    continue;
+                found.push_back(file.substr(prefix.size(), file.size() - prefix.size() - suffix.size()));
+            }
+            std::sort(found.begin(), found.end());
+            std::string path = (std::filesystem::path(directory) / "").string();
+            for (const std::string &name : found)
+                add(path, name, _defaults);
+            return found;
+        }
+
+        // path is the directory prefix handed to DLLoader::load
+        void add(const std::string &path, const std::string &name, PluginOptions options)
+        {
+            auto plugin = std::make_unique<Plugin>();
+            plugin->path = path;
+            plugin->name = name;
+            plugin->options = options;
+            _plugins[name] = std::move(plugin);
+        }
+
+        void setOptions(const std::string &name, PluginOptions options)
+        {
+            find(name).options = options;
+        }
+
+        // dlopens every registered, non-deferred plugin that is not loaded
+        // yet, on up to threads threads. Failures are collected and thrown
+        // together once every plugin has been attempted.
+        void loadAll(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            std::vector<Plugin *> pending;
+            for (auto &[_, plugin] : _plugins) {
+                if (!plugin->options.deferred && !plugin->loaded.load(std::memory_order_acquire))
+                    pending.push_back(plugin.get());
+            }
+
+            std::atomic<size_t> next{0};
+            std::mutex errorMutex;
+            std::string errors;
+            auto work = [&]() {
+                for (size_t i = next.fetch_add(1); i < pending.size(); i = next.fetch_add(1)) {
+                    try {
+                        ensureLoaded(*pending[i]);
+                    } catch (const std::exception &e) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        errors += (errors.empty() ? "" : "\n") + std::string(e.what());
+                    }
+                }
+            };
+            std::vector<std::thread> workers;
+            size_t count = std::min(std::max<size_t>(threads, 1), pending.size());
+            for (size_t i = 1; i < count; i++)
+                workers.emplace_back(work);
+            work();
+            for (auto &worker : workers)
+                worker.join();
+            if (!errors.empty())
+                throw std::runtime_error(errors);
+        }
+
+        // Loader of a plugin, dlopening it first if needed
+        DLLoader<T> &get(const std::string &name)
+        {
+            Plugin &plugin = find(name);
+            ensureLoaded(plugin);
+            return *plugin.loader;
+        }
+
+        template <typename Signature>
+        Signature *getSymbol(const std::string &plugin, const char *symbol)
+        {
+            return get(plugin).template getSymbol<Signature>(symbol);
+        }
+
+        template <typename... Args>
+        T *getInstance(const std::string &plugin, const char *symbol, Args &&...args)
+        {
+            return get(plugin).getInstance(symbol, std::forward<Args>(args)...);
+        }
+
+        bool contains(const std::string &name) const
+        {
+            return _plugins.count(name) != 0;
+        }
+
+        bool isLoaded(const std::string &name) const
+        {
+            auto it = _plugins.find(name);
+            return it != _plugins.end() && it->second->loaded.load(std::memory_order_acquire);
+        }
+
+        std::vector<std::string> names() const
+        {
+            std::vector<std::string> result;
+            result.reserve(_plugins.size());
+            for (const auto &[name, _] : _plugins)
+                result.push_back(name);
+            return result;
+        }
+
+    private:
+        struct Plugin {
+            std::string path;
+            std::string name;
+            PluginOptions options;
+            std::unique_ptr<DLLoader<T>> loader;
+            std::once_flag once;
+            std::atomic<bool> loaded{false};
+        };
+
+        Plugin &find(const std::string &name) const
+        {
+            auto it = _plugins.find(name);
+            if (it == _plugins.end())
+                throw std::runtime_error("Unknown plugin: " + name);
+            return *it->second;
+        }
+
+        // A failed load leaves the once_flag unset, so the next call retries
+        static void ensureLoaded(Plugin &plugin)
+        {
+            if (plugin.loaded.load(std::memory_order_acquire))
+                return;
+            std::call_once(plugin.once, [&plugin]() {
+                plugin.loader = std::make_unique<DLLoader<T>>(plugin.path, plugin.name, plugin.options.bind);
+                plugin.loaded.store(true, std::memory_order_release);
+            });
+        }
+
+        PluginOptions _defaults;
+        std::map<std::string, std::unique_ptr<Plugin>> _plugins;
+    };
+
+} // namespace cpputils
@@ -4,9 +4,38 @@
 #include <nlohmann/json.hpp>
 #include <iostream>
 #include <cmath>
+#include <charconv>
+#include <algorithm>
+#include <memory_resource>
+#include <type_traits>
 
 namespace cpputils::Math {
 
+    namespace detail {
+
+        // Shortest text that parses back to value; null for NaN and infinities
+        // as in nlohmann::json
+        template <typename T>
+        void appendJsonNumber(std::pmr::string &out, T value)
+        {
+            char buffer[32];
+            if constexpr (std::is_integral_v<T>) {
+                out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+            } else {
+                double number = value;
+                if (!std::isfinite(number)) {
+                    out += "null";
+                    return;
+                }
+                char *end = std::to_chars(buffer, buffer + sizeof(buffer), number).ptr;
+                out.append(buffer, end);
+                if (std::find_if(buffer, end, [](char c) { return c == '.' || c == 'e'; }) == end)
+                    out += ".0";
+            }
+        }
+
+    } // namespace detail
+
     // Vector2d
 
     template<typename T>
@@ -22,6 +51,8 @@ namespace cpputils::Math {
         Vector2 unit() const;
         void fromJson(const nlohmann::json &json);
         nlohmann::json toJson() const;
+        // JSON array text of toJson() without building the json tree
+        std::pmr::string toJsonString(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
 
         T x = 0;
         T y = 0;
@@ -99,6 +130,8 @@ namespace cpputils::Math {
         Vector3 unit() const;
         void fromJson(const nlohmann::json &json);
         nlohmann::json toJson() const;
+        // JSON array text of toJson() without building the json tree
+        std::pmr::string toJsonString(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
 
         T x = 0;
         T y = 0;
@@ -232,6 +265,19 @@ namespace cpputils::Math {
         return json;
     }
 
+    template<typename T>
+    std::pmr::string Vector2<T>::toJsonString(std::pmr::memory_resource *resource) const
+    {
+        std::pmr::string out(resource);
+        out.reserve(64);
+        out += '[';
+        detail::appendJsonNumber(out, x);
+        out += ',';
+        detail::appendJsonNumber(out, y);
+        out += ']';
+        return out;
+    }
+
     template<typename T>
     Vector2<T> operator+(const Vector2<T> &a, const Vector2<T> &b)
     {
@@ -427,6 +473,21 @@ namespace cpputils::Math {
         return json;
     }
 
+    template<typename T>
+    std::pmr::string Vector3<T>::toJsonString(std::pmr::memory_resource *resource) const
+    {
+        std::pmr::string out(resource);
+        out.reserve(96);
+        out += '[';
+        detail::appendJsonNumber(out, x);
+        out += ',';
+        detail::appendJsonNumber(out, y);
+        out += ',';
+        detail::appendJsonNumber(out, z);
+        out += ']';
+        return out;
+    }
+
     template<typename T>
     Vector3<T> operator+(const Vector3<T> &a, const Vector3<T> &b)
     {
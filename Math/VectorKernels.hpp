@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+#include "CpuFeatures.hpp"
+#include "Math.hpp"
+#include "Trace.hpp"
+
+namespace cpputils::Math {
+
+    namespace detail {
+
+        static_assert(sizeof(Vector3f) == 3 * sizeof(float), "Vector3f arrays are read as packed floats");
+
+        struct VectorKernels {
+            // a, b and out hold count packed (x, y, z) triples
+            void (*add)(const float *a, const float *b, float *out, size_t count);
+            void (*scale)(const float *a, float factor, float *out, size_t count);
+            void (*dot)(const float *a, const float *b, float *out, size_t count);
+        };
+
+CPPUTILS_FP_CONTRACT_OFF_BEGIN
+
+        inline void addScalar(const float *a, const float *b, float *out, size_t count)
+        {
+            for (size_t i = 0; i < count * 3; i++)
+                out[i] = a[i] + b[i];
+        }
+
+        inline void scaleScalar(const float *a, float factor, float *out, size_t count)
+        {
+            for (size_t i = 0; i < count * 3; i++)
+                out[i] = a[i] * factor;
+        }
+
+        inline void dotScalar(const float *a, const float *b, float *out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++, a += 3, b += 3)
+                out[i] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+#ifdef CPPUTILS_X86
+        // The dot kernels multiply four interleaved vectors at once
+        // (p0 = x0 y0 z0 x1, p1 = y1 z1 x2 y2, p2 = z2 x3 y3 z3) and
+        // regroup the products into x, y and z with in-lane shuffles, so the
+        // same sequence works on every 128-bit lane of the wider registers.
+
+        CPPUTILS_TARGET("sse2")
+        inline void addSse2(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            for (; i < n; i++)
+                out[i] = a[i] + b[i];
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void scaleSse2(const float *a, float factor, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            __m128 f = _mm_set1_ps(factor);
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), f));
+            for (; i < n; i++)
+                out[i] = a[i] * factor;
+        }
+
+        CPPUTILS_TARGET("sse2")
+        inline void dotSse2(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4, a += 12, b += 12) {
+                __m128 p0 = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+                __m128 p1 = _mm_mul_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4));
+                __m128 p2 = _mm_mul_ps(_mm_loadu_ps(a + 8), _mm_loadu_ps(b + 8));
+                __m128 x = _mm_shuffle_ps(p0, _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+                __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 1, 1)),
+                    _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 1, 2, 2)),
+                    _mm_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(x, y), z));
+            }
+            dotScalar(a, b, out + i, count - i);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void addAvx2(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            for (; i < n; i++)
+                out[i] = a[i] + b[i];
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void scaleAvx2(const float *a, float factor, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            __m256 f = _mm256_set1_ps(factor);
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), f));
+            for (; i < n; i++)
+                out[i] = a[i] * factor;
+        }
+
+        // Low lane from ptr, high lane from ptr + 12 (four vectors later)
+        CPPUTILS_TARGET("avx2")
+        inline __m256 loadLanes(const float *ptr)
+        {
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ptr)), _mm_loadu_ps(ptr + 12), 1);
+        }
+
+        CPPUTILS_TARGET("avx2")
+        inline void dotAvx2(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8, a += 24, b += 24) {
+                __m256 p0 = _mm256_mul_ps(loadLanes(a), loadLanes(b));
+                __m256 p1 = _mm256_mul_ps(loadLanes(a + 4), loadLanes(b + 4));
+                __m256 p2 = _mm256_mul_ps(loadLanes(a + 8), loadLanes(b + 8));
+                __m256 x = _mm256_shuffle_ps(p0, _mm256_shuffle_ps(p1, p2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+                __m256 y = _mm256_shuffle_ps(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 1, 1)),
+                    _mm256_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+                __m256 z = _mm256_shuffle_ps(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 1, 2, 2)),
+                    _mm256_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+                _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_add_ps(x, y), z));
+            }
+            dotSse2(a, b, out + i, count - i);
+        }
+
+        // GCC 12 reports its own AVX-512 intrinsics as reading uninitialized
+        // values (bug 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+        CPPUTILS_TARGET("avx512f")
+        inline void addAvx512(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+                _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+            if (i < n) {
+                __mmask16 mask = cpputils::detail::firstLanes(n - i);
+                _mm512_mask_storeu_ps(out + i, mask,
+                    _mm512_add_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i)));
+            }
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline void scaleAvx512(const float *a, float factor, float *out, size_t count)
+        {
+            size_t n = count * 3;
+            size_t i = 0;
+            __m512 f = _mm512_set1_ps(factor);
+            for (; i + 16 <= n; i += 16)
+                _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), f));
+            if (i < n) {
+                __mmask16 mask = cpputils::detail::firstLanes(n - i);
+                _mm512_mask_storeu_ps(out + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, a + i), f));
+            }
+        }
+
+        // Lane k from ptr + 12 * k
+        CPPUTILS_TARGET("avx512f")
+        inline __m512 loadLanes4(const float *ptr)
+        {
+            __m512 v = _mm512_castps128_ps512(_mm_loadu_ps(ptr));
+            v = _mm512_insertf32x4(v, _mm_loadu_ps(ptr + 12), 1);
+            v = _mm512_insertf32x4(v, _mm_loadu_ps(ptr + 24), 2);
+            return _mm512_insertf32x4(v, _mm_loadu_ps(ptr + 36), 3);
+        }
+
+        CPPUTILS_TARGET("avx512f")
+        inline __m512 dot16Avx512(const float *a, const float *b)
+        {
+            __m512 p0 = _mm512_mul_ps(loadLanes4(a), loadLanes4(b));
+            __m512 p1 = _mm512_mul_ps(loadLanes4(a + 4), loadLanes4(b + 4));
+            __m512 p2 = _mm512_mul_ps(loadLanes4(a + 8), loadLanes4(b + 8));
+            __m512 x = _mm512_shuffle_ps(p0, _mm512_shuffle_ps(p1, p2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+            __m512 y = _mm512_shuffle_ps(_mm512_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 1, 1)),
+                _mm512_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            __m512 z = _mm512_shuffle_ps(_mm512_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 1, 2, 2)),
+                _mm512_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+            return _mm512_add_ps(_mm512_add_ps(x, y), z);
+        }
+
+        // The tail goes through zero-padded copies rather than inlined
+        // scalar code, which could be contracted into FMA under this target
+        // where the fp-contract region has no effect
+        CPPUTILS_TARGET("avx512f")
+        inline void dotAvx512(const float *a, const float *b, float *out, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16, a += 48, b += 48)
+                _mm512_storeu_ps(out + i, dot16Avx512(a, b));
+            if (i < count) {
+                float tailA[48] = {};
+                float tailB[48] = {};
+                float tailOut[16];
+                std::memcpy(tailA, a, (count - i) * 3 * sizeof(float));
+                std::memcpy(tailB, b, (count - i) * 3 * sizeof(float));
+                _mm512_storeu_ps(tailOut, dot16Avx512(tailA, tailB));
+                std::memcpy(out + i, tailOut, (count - i) * sizeof(float));
+            }
+        }
+
+#if defined(__GNUC__) && !defined(__clang__)
+        #pragma GCC diagnostic pop
+#endif
+#endif
+
+CPPUTILS_FP_CONTRACT_OFF_END
+
+        inline const VectorKernels &vectorKernels()
+        {
+            static const VectorKernels tables[] = {
+                {addScalar, scaleScalar, dotScalar},
+#ifdef CPPUTILS_X86
+                {addSse2, scaleSse2, dotSse2},
+                {addAvx2, scaleAvx2, dotAvx2},
+                {addAvx512, scaleAvx512, dotAvx512},
+#endif
+            };
+            size_t level = static_cast<size_t>(simdLevel());
+            return tables[level < std::size(tables) ? level : 0];
+        }
+
+        inline const float *floats(const Vector3f *vectors)
+        {
+            return reinterpret_cast<const float *>(vectors);
+        }
+
+        inline float *floats(Vector3f *vectors)
+        {
+            return reinterpret_cast<float *>(vectors);
+        }
+
+    } // namespace detail
+
+    // Bulk operations on arrays of Vector3f, run with the widest instruction
+    // set the CPU supports (see simdLevel()). addVectors and scaleVectors
+    // may write over one of their inputs. Every SIMD level gives the same
+    // bits; dotVectors can differ in the last bit from Vector3 code that the
+    // compiler contracts into FMA.
+
+    inline void addVectors(const Vector3f *a, const Vector3f *b, Vector3f *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("addVectors");
+        detail::vectorKernels().add(detail::floats(a), detail::floats(b), detail::floats(out), count);
+    }
+
+    inline void scaleVectors(const Vector3f *a, float factor, Vector3f *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("scaleVectors");
+        detail::vectorKernels().scale(detail::floats(a), factor, detail::floats(out), count);
+    }
+
+    inline void dotVectors(const Vector3f *a, const Vector3f *b, float *out, size_t count)
+    {
+        CPPUTILS_TRACE_ZONE("dotVectors");
+        detail::vectorKernels().dot(detail::floats(a), detail::floats(b), out, count);
+    }
+
+} // namespace cpputils::Math
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+namespace cpputils {
+
+    // Bump allocator: allocating is a pointer increment and deallocate() does
+    // nothing. reset() drops everything at once but keeps the largest chunk,
+    // so a per-frame arena stops reaching upstream after the first frames.
+    // Not thread-safe.
+    class Arena : public std::pmr::memory_resource {
+    public:
+        // Position to come back to with rewind(). Invalidated by reset().
+        struct Marker {
+            void *chunk;
+            char *current;
+            size_t used;
+        };
+
+        explicit Arena(size_t chunkSize = 64 * 1024, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : _upstream(upstream), _nextSize(std::max(chunkSize, sizeof(Chunk) + alignof(std::max_align_t)))
+        {
+        }
+
+        // Serves allocations from buffer first; buffer is not owned
+        Arena(void *buffer, size_t size, size_t chunkSize = 64 * 1024, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : Arena(chunkSize, upstream)
+        {
+            _buffer = static_cast<char *>(buffer);
+            _bufferSize = size;
+            _current = _buffer;
+            _end = _buffer + size;
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+        ~Arena() override
+        {
+            release();
+        }
+
+        // Bytes handed out since construction or the last reset(), padding included
+        size_t used() const
+        {
+            return _used;
+        }
+
+        size_t capacity() const
+        {
+            size_t total = _bufferSize;
+            for (Chunk *chunk = _chunks; chunk; chunk = chunk->next)
+                total += chunk->size - sizeof(Chunk);
+            return total;
+        }
+
+        Marker mark() const
+        {
+            return Marker{_chunks, _current, _used};
+        }
+
+        // Frees everything allocated after marker was taken
+        void rewind(const Marker &marker)
+        {
+            while (_chunks != marker.chunk)
+                freeChunk();
+            _current = marker.current;
+            _end = _chunks ? chunkEnd(_chunks) : (_buffer ? _buffer + _bufferSize : nullptr);
+            _used = marker.used;
+        }
+
+        void reset()
+        {
+            Chunk *keep = nullptr;
+            for (Chunk *chunk = _chunks; chunk; chunk = chunk->next) {
+                if (!keep || chunk->size > keep->size)
+                    keep = chunk;
+            }
+            if (keep && keep->size - sizeof(Chunk) <= _bufferSize)
+                keep = nullptr;
+            while (_chunks) {
+                Chunk *chunk = _chunks;
+                _chunks = chunk->next;
+                if (chunk != keep)
+                    _upstream->deallocate(chunk, chunk->size, alignof(std::max_align_t));
+            }
+            if (keep) {
+                keep->next = nullptr;
+                _chunks = keep;
+                _current = chunkBegin(keep);
+                _end = chunkEnd(keep);
+            } else {
+                _current = _buffer;
+                _end = _buffer ? _buffer + _bufferSize : nullptr;
+            }
+            _used = 0;
+        }
+
+        // Returns every chunk to upstream
+        void release()
+        {
+            while (_chunks)
+                freeChunk();
+            _current = _buffer;
+            _end = _buffer ? _buffer + _bufferSize : nullptr;
+            _used = 0;
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            char *ptr = alignUp(_current, alignment);
+            if (!_current || ptr > _end || static_cast<size_t>(_end - ptr) < bytes) {
+                grow(bytes, alignment);
+                ptr = alignUp(_current, alignment);
+            }
+            _used += static_cast<size_t>(ptr + bytes - _current);
+            _current = ptr + bytes;
+            return ptr;
+        }
+
+        void do_deallocate(void *, size_t, size_t) override
+        {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        // Header at the start of every upstream chunk
+        struct alignas(std::max_align_t) Chunk {
+            Chunk *next;
+            size_t size;
+        };
+
+        // pmr alignments are powers of two
+        static char *alignUp(char *ptr, size_t alignment)
+        {
+            auto address = reinterpret_cast<uintptr_t>(ptr);
+            return ptr + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+        }
+
+        static char *chunkBegin(Chunk *chunk)
+        {
+            return reinterpret_cast<char *>(chunk) + sizeof(Chunk);
+        }
+
+        static char *chunkEnd(Chunk *chunk)
+        {
+            return reinterpret_cast<char *>(chunk) + chunk->size;
+        }
+
+        // Chunks double in size so a growing working set needs few of them
+        void grow(size_t bytes, size_t alignment)
+        {
+            size_t size = std::max(_nextSize, sizeof(Chunk) + bytes + alignment);
+            void *memory = _upstream->allocate(size, alignof(std::max_align_t));
+            _chunks = new (memory) Chunk{_chunks, size};
+            _current = chunkBegin(_chunks);
+            _end = chunkEnd(_chunks);
+            _nextSize = size * 2;
+        }
+
+        void freeChunk()
+        {
+            Chunk *chunk = _chunks;
+            _chunks = chunk->next;
+            _upstream->deallocate(chunk, chunk->size, alignof(std::max_align_t));
+        }
+
+        std::pmr::memory_resource *_upstream;
+        size_t _nextSize;
+        char *_buffer = nullptr;
+        size_t _bufferSize = 0;
+        Chunk *_chunks = nullptr;
+        char *_current = nullptr;
+        char *_end = nullptr;
+        size_t _used = 0;
+    };
+
+    // Rewinds the arena to where it was when the scope was entered
+    class ArenaScope {
+    public:
+        ArenaScope(Arena &arena)
+            : _arena(arena), _marker(arena.mark())
+        {
+        }
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+        ~ArenaScope()
+        {
+            _arena.rewind(_marker);
+        }
+
+    private:
+        Arena &_arena;
+        Arena::Marker _marker;
+    };
+
+} // namespace cpputils
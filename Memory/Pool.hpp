@@ -0,0 +1,162 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <memory_resource>
+
+namespace cpputils {
+
+    // Fixed-size blocks carved out of upstream chunks and recycled through a
+    // free list. Requests that do not fit a block go straight to upstream.
+    // Chunks are only returned when the pool is destroyed. Not thread-safe;
+    // see ThreadCache for a shared equivalent.
+    class Pool : public std::pmr::memory_resource {
+    public:
+        Pool(size_t blockSize, size_t alignment = alignof(std::max_align_t), size_t blocksPerChunk = 64,
+            std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : _alignment(std::max(alignment, alignof(FreeBlock))),
+              _blockSize(roundUp(std::max(blockSize, sizeof(FreeBlock)), _alignment)),
+              _blocksPerChunk(std::max<size_t>(blocksPerChunk, 1)),
+              _upstream(upstream)
+        {
+        }
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+        ~Pool() override
+        {
+            while (_chunks) {
+                Chunk *chunk = _chunks;
+                _chunks = chunk->next;
+                _upstream->deallocate(chunk->memory, chunkBytes(), _alignment);
+            }
+        }
+
+        size_t blockSize() const
+        {
+            return _blockSize;
+        }
+
+        size_t inUse() const
+        {
+            return _inUse;
+        }
+
+        size_t capacity() const
+        {
+            return _chunkCount * _blocksPerChunk;
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (bytes > _blockSize || alignment > _alignment)
+                return _upstream->allocate(bytes, alignment);
+            if (!_free)
+                grow();
+            FreeBlock *block = _free;
+            _free = block->next;
+            _inUse++;
+            return block;
+        }
+
+        void do_deallocate(void *ptr, size_t bytes, size_t alignment) override
+        {
+            if (bytes > _blockSize || alignment > _alignment) {
+                _upstream->deallocate(ptr, bytes, alignment);
+                return;
+            }
+            _free = new (ptr) FreeBlock{_free};
+            _inUse--;
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        // Stored after the blocks of the chunk it describes
+        struct Chunk {
+            Chunk *next;
+            void *memory;
+        };
+
+        static size_t roundUp(size_t size, size_t alignment)
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        size_t chunkBytes() const
+        {
+            return _blockSize * _blocksPerChunk + roundUp(sizeof(Chunk), _alignment);
+        }
+
+        void grow()
+        {
+            auto *memory = static_cast<char *>(_upstream->allocate(chunkBytes(), _alignment));
+            _chunks = new (memory + _blockSize * _blocksPerChunk) Chunk{_chunks, memory};
+            _chunkCount++;
+            for (size_t i = _blocksPerChunk; i-- > 0;)
+                _free = new (memory + i * _blockSize) FreeBlock{_free};
+        }
+
+        size_t _alignment;
+        size_t _blockSize;
+        size_t _blocksPerChunk;
+        std::pmr::memory_resource *_upstream;
+        FreeBlock *_free = nullptr;
+        Chunk *_chunks = nullptr;
+        size_t _chunkCount = 0;
+        size_t _inUse = 0;
+    };
+
+    // Typed front end of a Pool sized for T
+    template <typename T>
+    class ObjectPool {
+    public:
+        ObjectPool(size_t objectsPerChunk = 64, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : _pool(sizeof(T), alignof(T), objectsPerChunk, upstream)
+        {
+        }
+
+        template <typename... Args>
+        T *create(Args &&...args)
+        {
+            void *memory = _pool.allocate(sizeof(T), alignof(T));
+            try {
+                return new (memory) T(std::forward<Args>(args)...);
+            } catch (...) {
+                _pool.deallocate(memory, sizeof(T), alignof(T));
+                throw;
+            }
+        }
+
+        void destroy(T *object)
+        {
+            if (!object)
+                return;
+            object->~T();
+            _pool.deallocate(object, sizeof(T), alignof(T));
+        }
+
+        size_t inUse() const
+        {
+            return _pool.inUse();
+        }
+
+        Pool &resource()
+        {
+            return _pool;
+        }
+
+    private:
+        Pool _pool;
+    };
+
+} // namespace cpputils
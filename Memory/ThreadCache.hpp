@@ -0,0 +1,194 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <cstddef>
+#include <memory_resource>
+
+namespace cpputils {
+
+    // Process-wide allocator for small objects. Each thread keeps a short free
+    // list per size class and only takes a lock to move a batch of blocks from
+    // or to the shared lists, so a steady allocate/deallocate pattern neither
+    // locks nor reaches malloc. Blocks may be freed by any thread. Requests
+    // above maxBlockSize or over-aligned ones go to new/delete. Memory stays
+    // with the cache until the process exits.
+    class ThreadCache : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t maxBlockSize = 512;
+
+        // Never destroyed, so threads exiting during static destruction can
+        // still hand their blocks back
+        static ThreadCache &instance()
+        {
+            static ThreadCache *cache = new ThreadCache();
+            return *cache;
+        }
+
+        ThreadCache(const ThreadCache &) = delete;
+        ThreadCache &operator=(const ThreadCache &) = delete;
+
+        // Returns the calling thread's cached blocks to the shared lists
+        void flush()
+        {
+            if (!exited())
+                flush(local());
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (bytes > maxBlockSize || alignment > alignof(std::max_align_t))
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            size_t index = sizeClass(bytes);
+            if (exited())
+                return fetch(index, 1);
+            LocalList &list = local().lists[index];
+            if (!list.head) {
+                list.head = fetch(index, batchSize);
+                list.count = batchSize;
+            }
+            FreeBlock *block = list.head;
+            list.head = block->next;
+            list.count--;
+            return block;
+        }
+
+        void do_deallocate(void *ptr, size_t bytes, size_t alignment) override
+        {
+            if (bytes > maxBlockSize || alignment > alignof(std::max_align_t)) {
+                std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+                return;
+            }
+            size_t index = sizeClass(bytes);
+            if (exited()) {
+                release(index, new (ptr) FreeBlock{nullptr}, 1);
+                return;
+            }
+            LocalList &list = local().lists[index];
+            list.head = new (ptr) FreeBlock{list.head};
+            if (++list.count >= 2 * batchSize) {
+                FreeBlock *first = list.head;
+                FreeBlock *last = first;
+                for (size_t i = 1; i < batchSize; i++)
+                    last = last->next;
+                list.head = last->next;
+                list.count -= batchSize;
+                last->next = nullptr;
+                release(index, first, batchSize);
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        static constexpr size_t minBlockSize = 16;
+        static constexpr size_t classCount = 6;
+        static constexpr size_t batchSize = 32;
+        static constexpr size_t slabSize = 64 * 1024;
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        struct LocalList {
+            FreeBlock *head = nullptr;
+            size_t count = 0;
+        };
+
+        struct SharedList {
+            std::mutex mutex;
+            FreeBlock *head = nullptr;
+        };
+
+        struct LocalCache {
+            ~LocalCache()
+            {
+                ThreadCache::instance().flush(*this);
+                exited() = true;
+            }
+
+            LocalList lists[classCount];
+        };
+
+        ThreadCache() = default;
+
+        static LocalCache &local()
+        {
+            thread_local LocalCache cache;
+            return cache;
+        }
+
+        // Set once the thread's cache is torn down; later calls from other
+        // thread_local destructors go to the shared lists directly. Kept
+        // apart from LocalCache so it can still be read after it is gone.
+        static bool &exited()
+        {
+            thread_local bool flag = false;
+            return flag;
+        }
+
+        // 16, 32, ..., 512 bytes
+        static size_t sizeClass(size_t bytes)
+        {
+            size_t index = 0;
+            for (size_t size = minBlockSize; size < bytes; size <<= 1)
+                index++;
+            return index;
+        }
+
+        // Pops count blocks, carving a new slab when the shared list runs short
+        FreeBlock *fetch(size_t index, size_t count)
+        {
+            SharedList &shared = _shared[index];
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            FreeBlock *first = nullptr;
+            for (size_t i = 0; i < count; i++) {
+                if (!shared.head)
+                    shared.head = carve(index);
+                FreeBlock *block = shared.head;
+                shared.head = block->next;
+                block->next = first;
+                first = block;
+            }
+            return first;
+        }
+
+        void release(size_t index, FreeBlock *first, size_t count)
+        {
+            FreeBlock *last = first;
+            for (size_t i = 1; i < count; i++)
+                last = last->next;
+            SharedList &shared = _shared[index];
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            last->next = shared.head;
+            shared.head = first;
+        }
+
+        static FreeBlock *carve(size_t index)
+        {
+            FreeBlock *head = nullptr;
+            size_t blockSize = minBlockSize << index;
+            auto *slab = static_cast<char *>(std::pmr::new_delete_resource()->allocate(slabSize, alignof(std::max_align_t)));
+            for (size_t offset = slabSize; offset >= blockSize; offset -= blockSize)
+                head = new (slab + offset - blockSize) FreeBlock{head};
+            return head;
+        }
+
+        void flush(LocalCache &cache)
+        {
+            for (size_t index = 0; index < classCount; index++) {
+                LocalList &list = cache.lists[index];
+                if (list.head)
+                    release(index, list.head, list.count);
+                list = LocalList();
+            }
+        }
+
+        SharedList _shared[classCount];
+    };
+
+} // namespace cpputils
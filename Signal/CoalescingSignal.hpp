@@ -0,0 +1,165 @@
+#pragma once
+
+#include <tuple>
+#include <chrono>
+#include <optional>
+#include <type_traits>
+#include <cstdint>
+
+#include "Signal.hpp"
+
+namespace cpputils {
+
+    // Signal that holds on to its arguments until flush(). By default only
+    // the latest arguments are kept; a reducer can merge each new emit into
+    // the pending arguments instead (e.g. to sum deltas).
+    template <typename... Args>
+    struct CoalescingSignal {
+    public:
+        using Arguments = std::tuple<std::decay_t<Args>...>;
+        using Reducer = InplaceFunction<void(Arguments &, const Args &...)>;
+        using KeyType = u_int64_t;
+
+        CoalescingSignal() = default;
+        CoalescingSignal(Reducer reducer)
+            : _reducer(std::move(reducer))
+        {
+        }
+        ~CoalescingSignal() = default;
+
+        template <typename F>
+        Connection<Args...> connect(F &&callback)
+        {
+            return _signal.connect(std::forward<F>(callback));
+        }
+
+        void emit(const Args &...args)
+        {
+            if (_pending && _reducer)
+                _reducer(*_pending, args...);
+            else
+                _pending.emplace(args...);
+        }
+
+        bool pending() const
+        {
+            return _pending.has_value();
+        }
+
+        // Delivers the pending arguments once, if there are any
+        void flush()
+        {
+            if (!_pending)
+                return;
+            Arguments arguments = std::move(*_pending);
+            _pending.reset();
+            std::apply([this](const auto &...values) {
+                _signal.emit(values...);
+            }, arguments);
+        }
+
+        void discard()
+        {
+            _pending.reset();
+        }
+
+    private:
+        Signal<Args...> _signal;
+        Reducer _reducer;
+        std::optional<Arguments> _pending;
+    };
+
+    template <>
+    struct CoalescingSignal<void> : public CoalescingSignal<> {
+    public:
+        using CoalescingSignal<>::CoalescingSignal;
+
+        template <typename F>
+        Connection<void> connect(F &&callback)
+        {
+            return CoalescingSignal<>::connect(std::forward<F>(callback));
+        }
+    };
+
+    // Signal that delivers at most once per interval. An emit inside the
+    // interval is coalesced and delivered by the first emit or poll() after
+    // the interval has passed.
+    template <typename Clock, typename... Args>
+    struct BasicThrottledSignal {
+    public:
+        using Arguments = typename CoalescingSignal<Args...>::Arguments;
+        using Reducer = typename CoalescingSignal<Args...>::Reducer;
+        using Duration = typename Clock::duration;
+        using KeyType = u_int64_t;
+
+        BasicThrottledSignal(Duration interval, Reducer reducer = nullptr)
+            : _signal(std::move(reducer)), _interval(interval)
+        {
+        }
+        ~BasicThrottledSignal() = default;
+
+        template <typename F>
+        Connection<Args...> connect(F &&callback)
+        {
+            return _signal.connect(std::forward<F>(callback));
+        }
+
+        void emit(const Args &...args)
+        {
+            _signal.emit(args...);
+            poll();
+        }
+
+        // Delivers pending arguments if the interval has passed
+        void poll()
+        {
+            if (!_signal.pending())
+                return;
+            typename Clock::time_point now = Clock::now();
+            if (_delivered && now - *_delivered < _interval)
+                return;
+            _delivered = now;
+            _signal.flush();
+        }
+
+        // Delivers pending arguments now and restarts the interval
+        void flush()
+        {
+            if (!_signal.pending())
+                return;
+            _delivered = Clock::now();
+            _signal.flush();
+        }
+
+        bool pending() const
+        {
+            return _signal.pending();
+        }
+
+        void setInterval(Duration interval)
+        {
+            _interval = interval;
+        }
+
+    private:
+        CoalescingSignal<Args...> _signal;
+        Duration _interval;
+        std::optional<typename Clock::time_point> _delivered;
+    };
+
+    template <typename Clock>
+    struct BasicThrottledSignal<Clock, void> : public BasicThrottledSignal<Clock> {
+    public:
+        using BasicThrottledSignal<Clock>::BasicThrottledSignal;
+
+        template <typename F>
+        Connection<void> connect(F &&callback)
+        {
+            return BasicThrottledSignal<Clock>::connect(std::forward<F>(callback));
+        }
+    };
+
+    template <typename... Args>
+    using ThrottledSignal = BasicThrottledSignal<std::chrono::steady_clock, Args...>;
+
+} // namespace cpputils
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+#include "InplaceFunction.hpp"
+
+namespace cpputils {
+
+    namespace detail {
+
+        // Slot table shared by a ConcurrentSignal and its connections.
+        //
+        // Readers (emit) never block: they bump a reader counter for the
+        // current epoch parity, load the published snapshot and walk it.
+        // Writers copy the snapshot, publish the copy and retire the old one.
+        // A retired snapshot is freed once the epoch has advanced twice past
+        // it; the epoch only advances when the parity it reuses has no
+        // readers left, so no emit can still be looking at the snapshot.
+        // Reclamation never waits, which keeps connect/disconnect from inside
+        // a slot deadlock-free; leftovers are collected by later writes.
+        template <typename... Args>
+        struct ConcurrentSlots {
+            using Callback = InplaceFunction<void(const Args &...)>;
+            using KeyType = u_int64_t;
+
+            struct Slot {
+                KeyType id;
+                std::shared_ptr<const Callback> callback;
+            };
+
+            struct Snapshot {
+                std::vector<Slot> slots;
+            };
+
+            struct alignas(64) Counter {
+                std::atomic<u_int64_t> readers{0};
+            };
+
+            static constexpr size_t shards = 16;
+
+            ConcurrentSlots()
+                : current(new Snapshot())
+            {
+            }
+
+            ~ConcurrentSlots()
+            {
+                delete current.load();
+                for (auto &[_, snapshot] : retired)
+                    delete snapshot;
+            }
+
+            static size_t shard()
+            {
+                static std::atomic<size_t> next{0};
+                static thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % shards;
+                return index;
+            }
+
+            template <typename... EmitArgs>
+            void emit(const EmitArgs &...args) const
+            {
+                std::atomic<u_int64_t> &readers = counters[epoch.load() & 1][shard()].readers;
+                readers.fetch_add(1);
+                struct Guard {
+                    std::atomic<u_int64_t> &readers;
+                    ~Guard()
+                    {
+                        readers.fetch_sub(1, std::memory_order_release);
+                    }
+                } guard{readers};
+
+                const Snapshot *snapshot = current.load();
+                for (const Slot &slot : snapshot->slots)
+                    (*slot.callback)(args...);
+            }
+
+            // Callers hold mutex for everything below
+            void insert(KeyType id, std::shared_ptr<const Callback> callback)
+            {
+                auto next = new Snapshot(*current.load(std::memory_order_relaxed));
+                auto it = std::lower_bound(next->slots.begin(), next->slots.end(), id, [](const Slot &slot, KeyType key) {
+                    return slot.id < key;
+                });
+                next->slots.insert(it, Slot{id, std::move(callback)});
+                publish(next);
+            }
+
+            std::shared_ptr<const Callback> remove(KeyType id)
+            {
+                const Snapshot *snapshot = current.load(std::memory_order_relaxed);
+                auto it = std::lower_bound(snapshot->slots.begin(), snapshot->slots.end(), id, [](const Slot &slot, KeyType key) {
+                    return slot.id < key;
+                });
+                if (it == snapshot->slots.end() || it->id != id)
+                    return nullptr;
+                std::shared_ptr<const Callback> callback = it->callback;
+                auto next = new Snapshot();
+                next->slots.reserve(snapshot->slots.size() - 1);
+                for (const Slot &slot : snapshot->slots) {
+                    if (slot.id != id)
+                        next->slots.push_back(slot);
+                }
+                publish(next);
+                return callback;
+            }
+
+            void publish(const Snapshot *next)
+            {
+                const Snapshot *old = current.exchange(next);
+                retired.emplace_back(epoch.load(std::memory_order_relaxed), old);
+                reclaim();
+            }
+
+            bool drained(size_t parity) const
+            {
+                for (const Counter &counter : counters[parity]) {
+                    if (counter.readers.load() != 0)
+                        return false;
+                }
+                return true;
+            }
+
+            void reclaim()
+            {
+                for (int i = 0; i < 2; i++) {
+                    u_int64_t now = epoch.load(std::memory_order_relaxed);
+                    if (!drained((now + 1) & 1))
+                        break;
+                    epoch.store(now + 1);
+                }
+                u_int64_t now = epoch.load(std::memory_order_relaxed);
+                auto end = std::remove_if(retired.begin(), retired.end(), [now](const auto &entry) {
+                    if (entry.first + 2 > now)
+                        return false;
+                    delete entry.second;
+                    return true;
+                });
+                retired.erase(end, retired.end());
+            }
+
+            std::atomic<const Snapshot *> current;
+            std::atomic<u_int64_t> epoch{0};
+            mutable Counter counters[2][shards];
+            std::mutex mutex;
+            std::vector<std::pair<u_int64_t, const Snapshot *>> retired;
+            KeyType nextId = 0;
+        };
+
+    } // namespace detail
+
+    template <typename... Args>
+    struct ConcurrentConnection {
+    public:
+        using Slots = detail::ConcurrentSlots<Args...>;
+        using KeyType = u_int64_t;
+
+        ConcurrentConnection(KeyType id, const std::shared_ptr<Slots> &slots)
+            : _slots(slots), _id(id), _isConnected(true)
+        {
+        }
+        ~ConcurrentConnection() = default;
+
+        void disconnect()
+        {
+            std::shared_ptr<Slots> slots = _slots.lock();
+            if (_isConnected && slots) {
+                std::lock_guard<std::mutex> lock(slots->mutex);
+                _callback = slots->remove(_id);
+            }
+            _isConnected = false;
+        }
+
+        void reconnect()
+        {
+            std::shared_ptr<Slots> slots = _slots.lock();
+            if (!_isConnected && _callback && slots) {
+                std::lock_guard<std::mutex> lock(slots->mutex);
+                slots->insert(_id, _callback);
+                _isConnected = true;
+            }
+        }
+
+    private:
+        std::weak_ptr<Slots> _slots;
+        KeyType _id = 0;
+        bool _isConnected = false;
+        std::shared_ptr<const typename Slots::Callback> _callback;
+    };
+
+    template <>
+    struct ConcurrentConnection<void> : public ConcurrentConnection<> {
+    public:
+        ConcurrentConnection(const ConcurrentConnection<> &other)
+            : ConcurrentConnection<>(other)
+        {
+        }
+    };
+
+    // Signal that may be emitted, connected and disconnected from any number
+    // of threads at once. emit() is wait-free; connect and disconnect copy the
+    // slot table under a mutex.
+    template <typename... Args>
+    struct ConcurrentSignal {
+    public:
+        using Slots = detail::ConcurrentSlots<Args...>;
+        using Callback = typename Slots::Callback;
+        using KeyType = u_int64_t;
+
+        ConcurrentSignal()
+            : _slots(std::make_shared<Slots>())
+        {
+        }
+        ~ConcurrentSignal() = default;
+        ConcurrentSignal(const ConcurrentSignal &) = delete;
+        ConcurrentSignal &operator=(const ConcurrentSignal &) = delete;
+
+        template <typename F>
+        ConcurrentConnection<Args...> connect(F &&callback)
+        {
+            auto shared = std::make_shared<const Callback>(std::forward<F>(callback));
+            std::lock_guard<std::mutex> lock(_slots->mutex);
+            KeyType id = _slots->nextId++;
+            _slots->insert(id, std::move(shared));
+            return ConcurrentConnection<Args...>(id, _slots);
+        }
+
+        void emit(const Args &...args) const
+        {
+            _slots->emit(args...);
+        }
+
+        // Frees retired slot tables that no emit can reach anymore
+        void collect()
+        {
+            std::lock_guard<std::mutex> lock(_slots->mutex);
+            _slots->reclaim();
+        }
+
+    private:
+        std::shared_ptr<Slots> _slots;
+    };
+
+    template <>
+    struct ConcurrentSignal<void> : public ConcurrentSignal<> {
+    public:
+        template <typename F>
+        ConcurrentConnection<void> connect(F &&callback)
+        {
+            return ConcurrentSignal<>::connect(std::forward<F>(callback));
+        }
+    };
+
+} // namespace cpputils
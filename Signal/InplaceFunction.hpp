@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <memory_resource>
+
+namespace cpputils {
+
+    template <typename Signature, size_t Capacity = 4 * sizeof(void *)>
+    class InplaceFunction;
+
+    // std::function replacement that stores callables of up to Capacity bytes
+    // inside the object itself. Larger callables fall back to the heap, so
+    // anything a std::function accepts is accepted here too.
+    template <typename R, typename... Args, size_t Capacity>
+    class InplaceFunction<R(Args...), Capacity> {
+    public:
+        InplaceFunction() = default;
+        InplaceFunction(std::nullptr_t)
+        {
+        }
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction>
+            && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>>>
+        InplaceFunction(F &&callable)
+            : InplaceFunction(std::allocator_arg, std::pmr::new_delete_resource(), std::forward<F>(callable))
+        {
+        }
+
+        // Callables that do not fit inline are allocated from resource, which
+        // copies of this function keep using and which must outlive them
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction>
+            && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>>>
+        InplaceFunction(std::allocator_arg_t, std::pmr::memory_resource *resource, F &&callable)
+        {
+            using Callable = std::decay_t<F>;
+            if constexpr (isInline<Callable>) {
+                (void)resource;
+                new (&_storage) Callable(std::forward<F>(callable));
+                _ops = &inlineOps<Callable>;
+            } else {
+                *reinterpret_cast<Boxed<Callable> **>(&_storage) = box<Callable>(resource, std::forward<F>(callable));
+                _ops = &heapOps<Callable>;
+            }
+        }
+
+        InplaceFunction(const InplaceFunction &other)
+        {
+            if (other._ops)
+                other._ops->copy(&_storage, &other._storage);
+            _ops = other._ops;
+        }
+
+        InplaceFunction(InplaceFunction &&other) noexcept
+        {
+            if (other._ops)
+                other._ops->move(&_storage, &other._storage);
+            _ops = other._ops;
+            other._ops = nullptr;
+        }
+
+        ~InplaceFunction()
+        {
+            reset();
+        }
+
+        InplaceFunction &operator=(const InplaceFunction &other)
+        {
+            if (this != &other) {
+                InplaceFunction copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        InplaceFunction &operator=(InplaceFunction &&other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                if (other._ops)
+                    other._ops->move(&_storage, &other._storage);
+                _ops = other._ops;
+                other._ops = nullptr;
+            }
+            return *this;
+        }
+
+        R operator()(Args... args) const
+        {
+            if (!_ops)
+                throw std::bad_function_call();
+            return _ops->invoke(&_storage, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const
+        {
+            return _ops != nullptr;
+        }
+
+        void reset()
+        {
+            if (_ops)
+                _ops->destroy(&_storage);
+            _ops = nullptr;
+        }
+
+    private:
+        using Storage = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+
+        struct Ops {
+            R (*invoke)(void *storage, Args &&...args);
+            void (*copy)(void *dst, const void *src);
+            void (*move)(void *dst, void *src);
+            void (*destroy)(void *storage);
+        };
+
+        // Discards the callable's result when R is void
+        template <typename F>
+        static R call(F &callable, Args &&...args)
+        {
+            if constexpr (std::is_void_v<R>)
+                std::invoke(callable, std::forward<Args>(args)...);
+            else
+                return std::invoke(callable, std::forward<Args>(args)...);
+        }
+
+        template <typename F>
+        static constexpr bool isInline = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+        template <typename F>
+        static constexpr Ops inlineOps = {
+            [](void *storage, Args &&...args) -> R {
+                return call(*static_cast<F *>(storage), std::forward<Args>(args)...);
+            },
+            [](void *dst, const void *src) {
+                new (dst) F(*static_cast<const F *>(src));
+            },
+            [](void *dst, void *src) {
+                new (dst) F(std::move(*static_cast<F *>(src)));
+                static_cast<F *>(src)->~F();
+            },
+            [](void *storage) {
+                static_cast<F *>(storage)->~F();
+            }
+        };
+
+        template <typename F>
+        struct Boxed {
+            F callable;
+            std::pmr::memory_resource *resource;
+        };
+
+        template <typename F, typename Source>
+        static Boxed<F> *box(std::pmr::memory_resource *resource, Source &&callable)
+        {
+            void *memory = resource->allocate(sizeof(Boxed<F>), alignof(Boxed<F>));
+            try {
+                return new (memory) Boxed<F>{F(std::forward<Source>(callable)), resource};
+            } catch (...) {
+                resource->deallocate(memory, sizeof(Boxed<F>), alignof(Boxed<F>));
+                throw;
+            }
+        }
+
+        template <typename F>
+        static constexpr Ops heapOps = {
+            [](void *storage, Args &&...args) -> R {
+                return call((*static_cast<Boxed<F> **>(storage))->callable, std::forward<Args>(args)...);
+            },
+            [](void *dst, const void *src) {
+                const Boxed<F> *source = *static_cast<Boxed<F> *const *>(src);
+                *static_cast<Boxed<F> **>(dst) = box<F>(source->resource, source->callable);
+            },
+            [](void *dst, void *src) {
+                *static_cast<Boxed<F> **>(dst) = *static_cast<Boxed<F> **>(src);
+            },
+            [](void *storage) {
+                Boxed<F> *boxed = *static_cast<Boxed<F> **>(storage);
+                std::pmr::memory_resource *resource = boxed->resource;
+                boxed->~Boxed();
+                resource->deallocate(boxed, sizeof(Boxed<F>), alignof(Boxed<F>));
+            }
+        };
+
+        mutable Storage _storage;
+        const Ops *_ops = nullptr;
+    };
+
+} // namespace cpputils
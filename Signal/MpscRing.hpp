@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+namespace cpputils {
+
+    // Bounded multi-producer single-consumer queue. Every cell carries a
+    // sequence number (Vyukov's bounded queue), so producers claim a cell
+    // with one CAS and construct the value in place; nothing allocates after
+    // construction.
+    template <typename T>
+    class MpscRing {
+    public:
+        MpscRing(size_t capacity)
+        {
+            if (capacity == 0)
+                throw std::invalid_argument("MpscRing capacity must be positive");
+            size_t size = 1;
+            while (size < capacity)
+                size <<= 1;
+            _mask = size - 1;
+            _cells.reset(new Cell[size]);
+            for (size_t i = 0; i < size; i++)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        MpscRing(const MpscRing &) = delete;
+        MpscRing &operator=(const MpscRing &) = delete;
+        ~MpscRing()
+        {
+            while (pop([](T &) {}))
+                ;
+        }
+
+        size_t capacity() const
+        {
+            return _mask + 1;
+        }
+
+        // Approximate when producers are active
+        size_t size() const
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            size_t head = _head.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        bool empty() const
+        {
+            const Cell &cell = _cells[_head.load(std::memory_order_relaxed) & _mask];
+            return cell.sequence.load(std::memory_order_acquire) != _head.load(std::memory_order_relaxed) + 1;
+        }
+
+        // Returns false when the ring is full
+        template <typename... Values>
+        bool tryPush(Values &&...values)
+        {
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            Cell *cell;
+            for (;;) {
+                cell = &_cells[pos & _mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = _tail.load(std::memory_order_relaxed);
+                }
+            }
+            // The cell is already claimed, so a throwing constructor still
+            // has to publish it for the consumer to move past
+            try {
+                new (&cell->storage) T(std::forward<Values>(values)...);
+                cell->skip = false;
+            } catch (...) {
+                cell->skip = true;
+                cell->sequence.store(pos + 1, std::memory_order_release);
+                throw;
+            }
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Hands the front value to visitor, then destroys it.
+        template <typename Visitor>
+        bool pop(Visitor &&visitor)
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            Cell *next = &_cells[head & _mask];
+            for (;;) {
+                if (next->sequence.load(std::memory_order_acquire) != head + 1)
+                    return false;
+                if (!next->skip)
+                    break;
+                next->sequence.store(head + _mask + 1, std::memory_order_release);
+                _head.store(++head, std::memory_order_relaxed);
+                next = &_cells[head & _mask];
+            }
+            Cell &cell = *next;
+            T *value = std::launder(reinterpret_cast<T *>(&cell.storage));
+            struct Release {
+                MpscRing &ring;
+                Cell &cell;
+                T *value;
+                size_t head;
+                ~Release()
+                {
+                    value->~T();
+                    cell.sequence.store(head + ring._mask + 1, std::memory_order_release);
+                    ring._head.store(head + 1, std::memory_order_relaxed);
+                }
+            } release{*this, cell, value, head};
+            visitor(*value);
+            return true;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            // Set when constructing the value threw; pop() skips the cell
+            bool skip = false;
+            std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+        };
+
+        std::unique_ptr<Cell[]> _cells;
+        size_t _mask = 0;
+        alignas(64) std::atomic<size_t> _tail{0};
+        alignas(64) std::atomic<size_t> _head{0};
+    };
+
+} // namespace cpputils
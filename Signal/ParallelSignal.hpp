@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#include "Signal.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpputils {
+
+    // Combiners reduce the slot results of ParallelSignal::emitWith. They
+    // receive the results in connection order.
+
+    template <typename T>
+    struct SumCombiner {
+        using result_type = T;
+
+        T operator()(std::vector<T> &results) const
+        {
+            T sum = T();
+            for (const T &result : results)
+                sum = sum + result;
+            return sum;
+        }
+    };
+
+    template <typename T>
+    struct MinCombiner {
+        using result_type = std::optional<T>;
+
+        std::optional<T> operator()(std::vector<T> &results) const
+        {
+            if (results.empty())
+                return std::nullopt;
+            return *std::min_element(results.begin(), results.end());
+        }
+    };
+
+    template <typename T>
+    struct MaxCombiner {
+        using result_type = std::optional<T>;
+
+        std::optional<T> operator()(std::vector<T> &results) const
+        {
+            if (results.empty())
+                return std::nullopt;
+            return *std::max_element(results.begin(), results.end());
+        }
+    };
+
+    template <typename T>
+    struct CollectCombiner {
+        using result_type = std::vector<T>;
+
+        std::vector<T> operator()(std::vector<T> &results) const
+        {
+            return std::move(results);
+        }
+    };
+
+    // First result that converts to true (non-null pointer, engaged optional)
+    template <typename T>
+    struct FirstNonNullCombiner {
+        using result_type = T;
+
+        T operator()(std::vector<T> &results) const
+        {
+            for (T &result : results) {
+                if (result)
+                    return std::move(result);
+            }
+            return T();
+        }
+    };
+
+    template <typename Signature>
+    struct ParallelSignal;
+
+    // Signal whose slots run concurrently on a ThreadPool; emit returns once
+    // every slot has finished. Slots may run on any pool thread; they may
+    // emit the signal they are called from again, but must not connect or
+    // disconnect its slots.
+    template <typename R, typename... Args>
+    struct ParallelSignal<R(Args...)> {
+    public:
+        using Callback = typename detail::SlotList<R, Args...>::Callback;
+        using KeyType = u_int64_t;
+
+        // chunk is the number of slots handed to a thread at once; raise it
+        // when there are many cheap slots
+        ParallelSignal(ThreadPool &pool, size_t chunk = 1)
+            : _pool(pool), _chunk(chunk)
+        {
+        }
+        ~ParallelSignal() = default;
+
+        template <typename F>
+        BasicConnection<R, Args...> connect(F &&callback)
+        {
+            _slots.insert(_id, Callback(std::forward<F>(callback)));
+            return BasicConnection<R, Args...>(_id++, _slots);
+        }
+
+        void setChunkSize(size_t chunk)
+        {
+            _chunk = chunk;
+        }
+
+        void emit(const Args &...args)
+        {
+            typename detail::SlotList<R, Args...>::EmitGuard guard(_slots);
+            auto &slots = _slots.slots;
+            _pool.parallelFor(slots.size(), _chunk, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (slots[i].active)
+                        slots[i].callback(args...);
+                }
+            });
+        }
+
+        template <typename Combiner>
+        typename std::decay_t<Combiner>::result_type emitWith(Combiner &&combiner, const Args &...args)
+        {
+            static_assert(!std::is_void_v<R>, "emitWith needs slots that return a value");
+            typename detail::SlotList<R, Args...>::EmitGuard guard(_slots);
+            auto &slots = _slots.slots;
+            std::vector<std::optional<R>> results(slots.size());
+            _pool.parallelFor(slots.size(), _chunk, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (slots[i].active)
+                        results[i].emplace(slots[i].callback(args...));
+                }
+            });
+
+            std::vector<R> values;
+            values.reserve(results.size());
+            for (auto &result : results) {
+                if (result)
+                    values.push_back(std::move(*result));
+            }
+            return combiner(values);
+        }
+
+    private:
+        ThreadPool &_pool;
+        size_t _chunk;
+        detail::SlotList<R, Args...> _slots;
+        KeyType _id = 0;
+    };
+
+} // namespace cpputils
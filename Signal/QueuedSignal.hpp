@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <limits>
+#include <chrono>
+#include <optional>
+#include <type_traits>
+#include <condition_variable>
+#include <cstdint>
+
+#include "ConcurrentSignal.hpp"
+#include "MpscRing.hpp"
+
+namespace cpputils {
+
+    // What emit does when the queue is full
+    enum class Backpressure {
+        Block,      // wait for the dispatcher to make room
+        Drop,       // discard the new arguments
+        Coalesce    // keep only the newest overflowing arguments
+    };
+
+    struct QueueMetrics {
+        size_t depth = 0;
+        size_t capacity = 0;
+        size_t highWatermark = 0;
+        u_int64_t enqueued = 0;
+        u_int64_t dispatched = 0;
+        u_int64_t dropped = 0;
+        u_int64_t coalesced = 0;
+    };
+
+    // Signal whose slots run on a dispatcher instead of the emitting thread.
+    // emit() copies the arguments into a preallocated ring; dispatch() (from
+    // an event loop) or start() (on an owned thread) delivers them in batches.
+    template <typename... Args>
+    struct QueuedSignal {
+    public:
+        using Arguments = std::tuple<std::decay_t<Args>...>;
+        using KeyType = u_int64_t;
+
+        QueuedSignal(size_t capacity = 1024, Backpressure policy = Backpressure::Block)
+            : _queue(capacity), _policy(policy)
+        {
+        }
+        QueuedSignal(const QueuedSignal &) = delete;
+        QueuedSignal &operator=(const QueuedSignal &) = delete;
+        ~QueuedSignal()
+        {
+            stop();
+        }
+
+        template <typename F>
+        ConcurrentConnection<Args...> connect(F &&callback)
+        {
+            return _signal.connect(std::forward<F>(callback));
+        }
+
+        // Returns false when the arguments were dropped
+        bool emit(const Args &...args)
+        {
+            // Once arguments overflowed, newer ones replace them instead of
+            // overtaking them through the ring
+            if (_policy == Backpressure::Coalesce && _hasOverflow.load(std::memory_order_acquire)) {
+                coalesce(args...);
+                wake();
+                return true;
+            }
+            if (!_queue.tryPush(args...)) {
+                switch (_policy) {
+                case Backpressure::Drop:
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                case Backpressure::Coalesce:
+                    coalesce(args...);
+                    wake();
+                    return true;
+                default:
+                    while (!_queue.tryPush(args...))
+                        std::this_thread::yield();
+                }
+            }
+            _enqueued.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            return true;
+        }
+
+        // Delivers up to maxBatch queued emits on the calling thread. Only one
+        // thread may dispatch at a time.
+        size_t dispatch(size_t maxBatch = std::numeric_limits<size_t>::max())
+        {
+            size_t depth = _queue.size();
+            if (depth > _highWatermark.load(std::memory_order_relaxed))
+                _highWatermark.store(depth, std::memory_order_relaxed);
+
+            size_t count = 0;
+            while (count < maxBatch && _queue.pop([this](Arguments &arguments) {
+                deliver(arguments);
+            }))
+                count++;
+            // Emits bypass the ring while an overflow is pending, so once the
+            // ring is drained the overflow is the newest value
+            if (count < maxBatch && _hasOverflow.load(std::memory_order_acquire)) {
+                std::optional<Arguments> overflow;
+                lockOverflow();
+                overflow.swap(_overflow);
+                _hasOverflow.store(false, std::memory_order_relaxed);
+                _overflowLock.clear(std::memory_order_release);
+                if (overflow) {
+                    deliver(*overflow);
+                    count++;
+                }
+            }
+            _dispatched.fetch_add(count, std::memory_order_relaxed);
+            return count;
+        }
+
+        // Runs dispatch() on an owned thread until stop()
+        void start(size_t batch = 256)
+        {
+            if (_thread.joinable())
+                return;
+            _running.store(true);
+            _thread = std::thread([this, batch]() {
+                while (_running.load(std::memory_order_relaxed)) {
+                    if (dispatch(batch) > 0)
+                        continue;
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _sleeping.store(true);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (_queue.empty() && !_hasOverflow.load() && _running.load())
+                        _wakeup.wait_for(lock, std::chrono::milliseconds(10));
+                    _sleeping.store(false, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        // Stops the owned dispatcher and delivers what is still queued
+        void stop()
+        {
+            if (!_thread.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running.store(false);
+            }
+            _wakeup.notify_one();
+            _thread.join();
+            dispatch();
+        }
+
+        QueueMetrics metrics() const
+        {
+            QueueMetrics metrics;
+            metrics.depth = _queue.size();
+            metrics.capacity = _queue.capacity();
+            metrics.highWatermark = _highWatermark.load(std::memory_order_relaxed);
+            metrics.enqueued = _enqueued.load(std::memory_order_relaxed);
+            metrics.dispatched = _dispatched.load(std::memory_order_relaxed);
+            metrics.dropped = _dropped.load(std::memory_order_relaxed);
+            metrics.coalesced = _coalesced.load(std::memory_order_relaxed);
+            return metrics;
+        }
+
+    private:
+        void deliver(Arguments &arguments)
+        {
+            std::apply([this](auto &...values) {
+                _signal.emit(values...);
+            }, arguments);
+        }
+
+        void wake()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_sleeping.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _wakeup.notify_one();
+            }
+        }
+
+        void lockOverflow()
+        {
+            while (_overflowLock.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        // Slow path, only taken while the ring is full
+        void coalesce(const Args &...args)
+        {
+            lockOverflow();
+            if (_overflow)
+                _coalesced.fetch_add(1, std::memory_order_relaxed);
+            else
+                _enqueued.fetch_add(1, std::memory_order_relaxed);
+            _overflow.emplace(args...);
+            _hasOverflow.store(true, std::memory_order_release);
+            _overflowLock.clear(std::memory_order_release);
+        }
+
+        ConcurrentSignal<Args...> _signal;
+        MpscRing<Arguments> _queue;
+        Backpressure _policy;
+
+        std::atomic_flag _overflowLock = ATOMIC_FLAG_INIT;
+        std::atomic<bool> _hasOverflow{false};
+        std::optional<Arguments> _overflow;
+
+        std::atomic<u_int64_t> _enqueued{0};
+        std::atomic<u_int64_t> _dispatched{0};
+        std::atomic<u_int64_t> _dropped{0};
+        std::atomic<u_int64_t> _coalesced{0};
+        std::atomic<size_t> _highWatermark{0};
+
+        std::thread _thread;
+        std::atomic<bool> _running{false};
+        std::atomic<bool> _sleeping{false};
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+    };
+
+    template <>
+    struct QueuedSignal<void> : public QueuedSignal<> {
+    public:
+        using QueuedSignal<>::QueuedSignal;
+
+        template <typename F>
+        ConcurrentConnection<void> connect(F &&callback)
+        {
+            return QueuedSignal<>::connect(std::forward<F>(callback));
+        }
+    };
+
+} // namespace cpputils
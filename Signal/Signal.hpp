@@ -1,85 +1,157 @@
 #pragma once
 
-#include <map>
-#include <functional>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
 #include <iostream>
 #include <cstdint>
+#include <memory_resource>
+
+#include "InplaceFunction.hpp"
+#include "Trace.hpp"
+
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+    #include "SignalProfiler.hpp"
+#endif
 
 namespace cpputils {
 
-    template <typename... Args>
-    struct Connection {
-    public:
-        using Callback = std::function<void(Args...)>;
-        using KeyType = u_int64_t;
+    namespace detail {
 
-        Connection(KeyType id, std::map<KeyType, const Callback> &callbacks)
-            : _id(id), _callbacks(callbacks), _isConnected(true)
-        {
-        }
-        ~Connection() = default;
+        // Slots live in one contiguous vector ordered by id, so emit is a
+        // linear walk. Disconnecting while an emit is running only marks the
+        // slot inactive, and connecting queues the slot in pending; both are
+        // folded back in once the outermost emit returns.
+        template <typename R, typename... Args>
+        struct SlotList {
+            using Callback = InplaceFunction<R(const Args &...)>;
+            using KeyType = u_int64_t;
 
-        Connection &operator=(const Connection &other)
-        {
-            if (this != &other) {
-                _id = other._id;
-                _callbacks = other._callbacks;
-                _isConnected = other._isConnected;
-                _callback = other._callback;
+            struct Slot {
+                KeyType id;
+                bool active;
+                Callback callback;
+            };
+
+            SlotList(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+                : slots(resource), pending(resource)
+            {
             }
-            return *this;
-        }
 
-        void disconnect()
-        {
-            if (_isConnected) {
-                _callback = _callbacks.at(_id);
-                _callbacks.erase(_id);
-                _isConnected = false;
+            void insert(KeyType id, Callback callback)
+            {
+                if (emitting.load(std::memory_order_relaxed) > 0) {
+                    pending.push_back(Slot{id, true, std::move(callback)});
+                    return;
+                }
+                auto it = std::lower_bound(slots.begin(), slots.end(), id, [](const Slot &slot, KeyType key) {
+                    return slot.id < key;
+                });
+                slots.insert(it, Slot{id, true, std::move(callback)});
             }
-        }
 
-        void reconnect()
-        {
-            if (!_isConnected) {
-                _callbacks.emplace(_id, _callback);
-                _isConnected = true;
+            // Returns false when the id has no live slot
+            bool remove(KeyType id, Callback &callback)
+            {
+                auto it = std::lower_bound(slots.begin(), slots.end(), id, [](const Slot &slot, KeyType key) {
+                    return slot.id < key;
+                });
+                if (it != slots.end() && it->id == id && it->active) {
+                    if (emitting.load(std::memory_order_relaxed) > 0) {
+                        // The slot may be the one running, so it must stay intact
+                        callback = it->callback;
+                        it->active = false;
+                        dead++;
+                    } else {
+                        callback = std::move(it->callback);
+                        slots.erase(it);
+                    }
+                    return true;
+                }
+                auto queued = std::find_if(pending.begin(), pending.end(), [id](const Slot &slot) {
+                    return slot.id == id;
+                });
+                if (queued == pending.end())
+                    return false;
+                callback = std::move(queued->callback);
+                pending.erase(queued);
+                return true;
             }
-        }
 
-    private:
-        std::map<KeyType, const Callback> &_callbacks;
-        KeyType _id = 0;
-        bool _isConnected = false;
-        Callback _callback;
-    };
+            void flush()
+            {
+                if (dead > 0) {
+                    slots.erase(std::remove_if(slots.begin(), slots.end(), [](const Slot &slot) {
+                        return !slot.active;
+                    }), slots.end());
+                    dead = 0;
+                }
+                std::pmr::vector<Slot> queued = std::move(pending);
+                pending.clear();
+                for (Slot &slot : queued)
+                    insert(slot.id, std::move(slot.callback));
+            }
 
-    template <>
-    struct Connection<void> {
+            // Held for the duration of an emit; slots may not move meanwhile.
+            // ParallelSignal slots may emit the same signal again from pool
+            // threads, so the nesting count is atomic.
+            struct EmitGuard {
+                EmitGuard(SlotList &list)
+                    : list(list)
+                {
+                    list.emitting.fetch_add(1, std::memory_order_relaxed);
+                }
+                ~EmitGuard()
+                {
+                    if (list.emitting.fetch_sub(1, std::memory_order_acq_rel) == 1
+                        && (list.dead > 0 || !list.pending.empty()))
+                        list.flush();
+                }
+                SlotList &list;
+            };
+
+            template <typename... EmitArgs>
+            void emit(const EmitArgs &...args)
+            {
+                EmitGuard guard(*this);
+                size_t count = slots.size();
+                for (size_t i = 0; i < count; i++) {
+                    const Slot &slot = slots[i];
+                    if (slot.active)
+                        slot.callback(args...);
+                }
+            }
+
+            std::pmr::memory_resource *resource() const
+            {
+                return slots.get_allocator().resource();
+            }
+
+            std::pmr::vector<Slot> slots;
+            std::pmr::vector<Slot> pending;
+            size_t dead = 0;
+            std::atomic<int> emitting{0};
+        };
+
+    } // namespace detail
+
+    template <typename R, typename... Args>
+    struct BasicConnection {
     public:
-        using Callback = std::function<void()>;
+        using Callback = typename detail::SlotList<R, Args...>::Callback;
         using KeyType = u_int64_t;
 
-        Connection(KeyType id, std::map<KeyType, const Callback> &callbacks)
-            : _id(id), _callbacks(callbacks), _isConnected(true) {}
-        ~Connection() = default;
-
-        Connection &operator=(const Connection &other)
+        BasicConnection(KeyType id, detail::SlotList<R, Args...> &slots)
+            : _slots(&slots), _id(id), _isConnected(true)
         {
-            if (this != &other) {
-                _id = other._id;
-                _callbacks = other._callbacks;
-                _isConnected = other._isConnected;
-                _callback = other._callback;
-            }
-            return *this;
         }
+        ~BasicConnection() = default;
 
         void disconnect()
         {
             if (_isConnected) {
-                _callback = _callbacks.at(_id);
-                _callbacks.erase(_id);
+                _slots->remove(_id, _callback);
                 _isConnected = false;
             }
         }
@@ -87,70 +159,131 @@ namespace cpputils {
         void reconnect()
         {
             if (!_isConnected) {
-                _callbacks.emplace(_id, _callback);
+                _slots->insert(_id, _callback);
                 _isConnected = true;
             }
         }
 
     private:
-        std::map<KeyType, const Callback> &_callbacks;
+        detail::SlotList<R, Args...> *_slots;
         KeyType _id = 0;
         bool _isConnected = false;
         Callback _callback;
     };
 
+    template <typename... Args>
+    struct Connection : public BasicConnection<void, Args...> {
+    public:
+        using BasicConnection<void, Args...>::BasicConnection;
+    };
+
+    template <>
+    struct Connection<void> : public Connection<> {
+    public:
+        Connection(const Connection<> &other)
+            : Connection<>(other)
+        {
+        }
+    };
+
     template <typename... Args>
     struct Signal {
     public:
-        using Callback = const std::function<void(Args...)>;
+        using Callback = typename detail::SlotList<void, Args...>::Callback;
         using KeyType = u_int64_t;
 
         Signal() = default;
+        // Slot storage and callbacks too large for InplaceFunction come from
+        // resource, which must outlive the signal and its connections
+        explicit Signal(std::pmr::memory_resource *resource)
+            : _slots(resource)
+        {
+        }
+        // Named signals report to SignalProfiler when built with
+        // CPPUTILS_SIGNAL_INSTRUMENTATION; the name is ignored otherwise
+        explicit Signal(const std::string &name, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : _slots(resource)
+        {
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+            _stats = &SignalProfiler::instance().signal(name);
+#else
+            (void)name;
+#endif
+        }
         ~Signal() = default;
 
-        Connection<Args...> connect(Callback &callback)
+        template <typename F>
+        Connection<Args...> connect(F &&callback)
         {
-            _callbacks.emplace(_id, callback);
-            return Connection<Args...>(_id++, _callbacks);
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+            if (_stats)
+                return connectTimed(std::forward<F>(callback), _stats->addUnnamedSlot());
+#endif
+            _slots.insert(_id, Callback(std::allocator_arg, _slots.resource(), std::forward<F>(callback)));
+            return Connection<Args...>(_id++, _slots);
         }
 
-        void emit(Args... args)
+        template <typename F>
+        Connection<Args...> connect(F &&callback, const std::string &name)
         {
-            for (auto &[_, callback] : _callbacks) {
-                callback(args...);
-            }
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+            if (_stats)
+                return connectTimed(std::forward<F>(callback), _stats->addSlot(name));
+#else
+            (void)name;
+#endif
+            _slots.insert(_id, Callback(std::allocator_arg, _slots.resource(), std::forward<F>(callback)));
+            return Connection<Args...>(_id++, _slots);
+        }
+
+        void emit(const Args &...args)
+        {
+            CPPUTILS_TRACE_ZONE("Signal::emit");
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+            if (_stats)
+                _stats->emits.fetch_add(1, std::memory_order_relaxed);
+#endif
+            _slots.emit(args...);
         }
 
     private:
-        std::map<KeyType, Callback> _callbacks;
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+        template <typename F>
+        Connection<Args...> connectTimed(F &&callback, SlotStats &stats)
+        {
+            SlotStats *slot = &stats;
+            const SignalStats *signal = _stats;
+            _slots.insert(_id, Callback(std::allocator_arg, _slots.resource(), [callback = std::decay_t<F>(std::forward<F>(callback)), signal, slot](const Args &...args) mutable {
+                detail::SlotTimer timer(signal, slot);
+                callback(args...);
+            }));
+            return Connection<Args...>(_id++, _slots);
+        }
+#endif
+
+        detail::SlotList<void, Args...> _slots;
         KeyType _id = 0;
+#ifdef CPPUTILS_SIGNAL_INSTRUMENTATION
+        SignalStats *_stats = nullptr;
+#endif
     };
 
     template <>
-    struct Signal<void> {
+    struct Signal<void> : public Signal<> {
     public:
-        using Callback = const std::function<void()>;
-        using KeyType = u_int64_t;
-
-        Signal() = default;
-        ~Signal() = default;
+        using Signal<>::Signal;
 
-        Connection<void> connect(Callback &callback)
+        template <typename F>
+        Connection<void> connect(F &&callback)
         {
-            _callbacks.emplace(_id, callback);
-            return Connection<void>(_id++, _callbacks);
+            return Signal<>::connect(std::forward<F>(callback));
         }
 
-        void emit()
+        template <typename F>
+        Connection<void> connect(F &&callback, const std::string &name)
         {
-            for (auto &[_, callback] : _callbacks) {
-                callback();
-            }
+            return Signal<>::connect(std::forward<F>(callback), name);
         }
-
-    private:
-        std::map<KeyType, Callback> _callbacks;
-        KeyType _id = 0;
     };
 
 } // namespace cpputils
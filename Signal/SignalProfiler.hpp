@@ -0,0 +1,239 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+
+#include "JsonString.hpp"
+
+namespace cpputils {
+
+    // Per-slot counters. The histogram has one bucket per power of two
+    // nanoseconds: bucket i counts calls that took [2^i, 2^(i + 1)) ns.
+    struct SlotStats {
+        static constexpr size_t buckets = 32;
+
+        SlotStats(const std::string &name)
+            : name(name)
+        {
+        }
+
+        void record(u_int64_t nanoseconds)
+        {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            totalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+            u_int64_t max = maxNs.load(std::memory_order_relaxed);
+            while (nanoseconds > max && !maxNs.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+                ;
+            size_t bucket = 0;
+            while (bucket + 1 < buckets && (nanoseconds >> (bucket + 1)) != 0)
+                bucket++;
+            histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void reset()
+        {
+            calls.store(0, std::memory_order_relaxed);
+            totalNs.store(0, std::memory_order_relaxed);
+            maxNs.store(0, std::memory_order_relaxed);
+            for (auto &bucket : histogram)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+
+        const std::string name;
+        std::atomic<u_int64_t> calls{0};
+        std::atomic<u_int64_t> totalNs{0};
+        std::atomic<u_int64_t> maxNs{0};
+        std::atomic<u_int64_t> histogram[buckets] = {};
+    };
+
+    struct SignalStats {
+        static constexpr size_t unnamedSlots = 16;
+
+        SignalStats(const std::string &name)
+            : name(name)
+        {
+        }
+
+        // Slots connected under the same name share their stats, so
+        // connect/disconnect churn does not grow the registry
+        SlotStats &addSlot(const std::string &slotName)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (SlotStats &slot : _slots) {
+                if (slot.name == slotName)
+                    return slot;
+            }
+            return _slots.emplace_back(slotName);
+        }
+
+        // Stats for a slot connected without a name: "<signal>/slot#N" in
+        // connection order, with everything past the first unnamedSlots
+        // connections sharing "<signal>/slot#other"
+        SlotStats &addUnnamedSlot()
+        {
+            size_t index = _unnamed.fetch_add(1, std::memory_order_relaxed);
+            return addSlot(name + "/slot#" + (index < unnamedSlots ? std::to_string(index) : "other"));
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            emits.store(0, std::memory_order_relaxed);
+            for (SlotStats &slot : _slots)
+                slot.reset();
+        }
+
+        template <typename Visitor>
+        void forEachSlot(Visitor &&visitor) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const SlotStats &slot : _slots)
+                visitor(slot);
+        }
+
+        const std::string name;
+        std::atomic<u_int64_t> emits{0};
+
+    private:
+        mutable std::mutex _mutex;
+        std::deque<SlotStats> _slots;
+        std::atomic<size_t> _unnamed{0};
+    };
+
+    // Process-wide registry of signal statistics. Signals only report here
+    // when the library is built with CPPUTILS_SIGNAL_INSTRUMENTATION;
+    // otherwise the hooks compile to nothing and the registry stays empty.
+    class SignalProfiler {
+    public:
+        using SlowSlotHandler = std::function<void(const SignalStats &, const SlotStats &, std::chrono::nanoseconds)>;
+
+        static SignalProfiler &instance()
+        {
+            static SignalProfiler profiler;
+            return profiler;
+        }
+
+        // Stats live until the end of the program; signals sharing a name
+        // share their stats
+        SignalStats &signal(const std::string &name)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (SignalStats &stats : _signals) {
+                if (stats.name == name)
+                    return stats;
+            }
+            return _signals.emplace_back(name);
+        }
+
+        // handler runs on the emitting thread after any slot slower than threshold
+        void setSlowSlotHandler(std::chrono::nanoseconds threshold, SlowSlotHandler handler)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _handler = std::make_shared<SlowSlotHandler>(std::move(handler));
+            _threshold.store(_handler && *_handler ? threshold.count() : 0, std::memory_order_relaxed);
+        }
+
+        void record(const SignalStats &signal, SlotStats &slot, u_int64_t nanoseconds)
+        {
+            slot.record(nanoseconds);
+            u_int64_t threshold = _threshold.load(std::memory_order_relaxed);
+            if (threshold == 0 || nanoseconds < threshold)
+                return;
+            std::shared_ptr<SlowSlotHandler> handler;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                handler = _handler;
+            }
+            if (handler && *handler)
+                (*handler)(signal, slot, std::chrono::nanoseconds(nanoseconds));
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (SignalStats &stats : _signals)
+                stats.reset();
+        }
+
+        void dumpText(std::ostream &os) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const SignalStats &stats : _signals) {
+                os << stats.name << ": " << stats.emits.load() << " emits\n";
+                stats.forEachSlot([&os](const SlotStats &slot) {
+                    u_int64_t calls = slot.calls.load();
+                    os << "  " << slot.name << ": " << calls << " calls, avg "
+                        << (calls ? slot.totalNs.load() / calls : 0) << " ns, max " << slot.maxNs.load() << " ns\n";
+                });
+            }
+        }
+
+        void dumpJson(std::ostream &os) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            os << "{\"signals\":[";
+            bool firstSignal = true;
+            for (const SignalStats &stats : _signals) {
+                os << (firstSignal ? "" : ",") << "{\"name\":";
+                detail::writeJsonString(os, stats.name);
+                os << ",\"emits\":" << stats.emits.load() << ",\"slots\":[";
+                firstSignal = false;
+                bool firstSlot = true;
+                stats.forEachSlot([&](const SlotStats &slot) {
+                    os << (firstSlot ? "" : ",") << "{\"name\":";
+                    detail::writeJsonString(os, slot.name);
+                    os << ",\"calls\":" << slot.calls.load() << ",\"totalNs\":" << slot.totalNs.load()
+                        << ",\"maxNs\":" << slot.maxNs.load() << ",\"histogram\":[";
+                    for (size_t i = 0; i < SlotStats::buckets; i++)
+                        os << (i ? "," : "") << slot.histogram[i].load();
+                    os << "]}";
+                    firstSlot = false;
+                });
+                os << "]}";
+            }
+            os << "]}";
+        }
+
+    private:
+        SignalProfiler() = default;
+
+        mutable std::mutex _mutex;
+        std::deque<SignalStats> _signals;
+        std::shared_ptr<SlowSlotHandler> _handler;
+        std::atomic<u_int64_t> _threshold{0};
+    };
+
+    namespace detail {
+
+        // Times one slot call from construction to destruction
+        struct SlotTimer {
+            SlotTimer(const SignalStats *signal, SlotStats *slot)
+                : signal(signal), slot(slot)
+            {
+                if (slot)
+                    start = std::chrono::steady_clock::now();
+            }
+            ~SlotTimer()
+            {
+                if (!slot)
+                    return;
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                SignalProfiler::instance().record(*signal, *slot,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+
+            const SignalStats *signal;
+            SlotStats *slot;
+            std::chrono::steady_clock::time_point start;
+        };
+
+    } // namespace detail
+
+} // namespace cpputils
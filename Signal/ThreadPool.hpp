@@ -0,0 +1,144 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+
+#include "InplaceFunction.hpp"
+
+namespace cpputils {
+
+    // Fixed set of worker threads for fork-join work. The thread calling
+    // parallelFor() takes chunks too, so nested calls from inside a task
+    // always make progress even when every worker is busy.
+    class ThreadPool {
+    public:
+        using Task = InplaceFunction<void()>;
+
+        ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            _workers.reserve(threads);
+            for (size_t i = 0; i < threads; i++)
+                _workers.emplace_back([this]() { work(); });
+        }
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _wakeup.notify_all();
+            for (auto &worker : _workers)
+                worker.join();
+        }
+
+        size_t size() const
+        {
+            return _workers.size();
+        }
+
+        void submit(Task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _tasks.push_back(std::move(task));
+            }
+            _wakeup.notify_one();
+        }
+
+        // Calls fn(begin, end) over [0, count) in chunks of at most chunk
+        // indices and returns once all of them ran. The first exception
+        // thrown by fn is rethrown here.
+        template <typename F>
+        void parallelFor(size_t count, size_t chunk, F &&fn)
+        {
+            if (count == 0)
+                return;
+            chunk = std::max<size_t>(chunk, 1);
+            size_t chunks = (count + chunk - 1) / chunk;
+            if (chunks == 1 || _workers.empty()) {
+                fn(size_t(0), count);
+                return;
+            }
+
+            struct Job {
+                std::atomic<size_t> next{0};
+                std::atomic<size_t> done{0};
+                size_t count;
+                size_t chunk;
+                std::remove_reference_t<F> *fn;
+                std::mutex mutex;
+                std::condition_variable finished;
+                std::exception_ptr error;
+
+                void run()
+                {
+                    for (;;) {
+                        size_t begin = next.fetch_add(chunk);
+                        if (begin >= count)
+                            return;
+                        size_t end = std::min(begin + chunk, count);
+                        try {
+                            (*fn)(begin, end);
+                        } catch (...) {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (!error)
+                                error = std::current_exception();
+                        }
+                        if (done.fetch_add(end - begin) + (end - begin) == count) {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            finished.notify_all();
+                        }
+                    }
+                }
+            };
+
+            auto job = std::make_shared<Job>();
+            job->count = count;
+            job->chunk = chunk;
+            job->fn = &fn;
+            size_t helpers = std::min(_workers.size(), chunks - 1);
+            for (size_t i = 0; i < helpers; i++)
+                submit([job]() { job->run(); });
+            job->run();
+
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->finished.wait(lock, [&job]() { return job->done.load() == job->count; });
+            if (job->error)
+                std::rethrow_exception(job->error);
+        }
+
+    private:
+        void work()
+        {
+            for (;;) {
+                Task task;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wakeup.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+                    if (_tasks.empty())
+                        return;
+                    task = std::move(_tasks.front());
+                    _tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> _workers;
+        std::deque<Task> _tasks;
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        bool _stopping = false;
+    };
+
+} // namespace cpputils
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <string_view>
+
+namespace cpputils {
+
+    namespace detail {
+
+        // Appends value as a quoted JSON string. Quotes, backslashes and
+        // control characters are escaped so the original text round-trips;
+        // other bytes, UTF-8 included, are copied as they are.
+        inline void appendJsonString(std::string &out, std::string_view value)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+            out += '"';
+            size_t start = 0;
+            for (size_t i = 0; i < value.size(); i++) {
+                auto c = static_cast<unsigned char>(value[i]);
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+                out.append(value.data() + start, i - start);
+                start = i + 1;
+                switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\b':
+                    out += "\\b";
+                    break;
+                case '\f':
+                    out += "\\f";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default: {
+                    char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                    out.append(escape, sizeof(escape));
+                }
+                }
+            }
+            out.append(value.data() + start, value.size() - start);
+            out += '"';
+        }
+
+        inline void writeJsonString(std::ostream &os, std::string_view value)
+        {
+            std::string out;
+            appendJsonString(out, value);
+            os.write(out.data(), static_cast<std::streamsize>(out.size()));
+        }
+
+    } // namespace detail
+
+} // namespace cpputils
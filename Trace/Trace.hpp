@@ -0,0 +1,35 @@
+#pragma once
+
+// Hot-path instrumentation. With CPPUTILS_TRACE_INSTRUMENTATION defined the
+// macros record into the calling thread's TraceBuffer while Tracer is
+// running; otherwise they expand to nothing and their arguments are not
+// evaluated. Names must be string literals.
+//
+//     CPPUTILS_TRACE_ZONE("Renderer::draw");       // scope duration
+//     CPPUTILS_TRACE_COUNTER("queue depth", size);  // value over time
+//     CPPUTILS_TRACE_FLOW_BEGIN("job", id);         // arrow from here to
+//     CPPUTILS_TRACE_FLOW_END("job", id);           // the zone around this
+//
+// Recording itself is started with Tracer::instance().start(path).
+
+#ifdef CPPUTILS_TRACE_INSTRUMENTATION
+
+    #include "Tracer.hpp"
+
+    #define CPPUTILS_TRACE_CONCAT_(a, b) a##b
+    #define CPPUTILS_TRACE_CONCAT(a, b) CPPUTILS_TRACE_CONCAT_(a, b)
+    #define CPPUTILS_TRACE_ZONE(name) ::cpputils::TraceZone CPPUTILS_TRACE_CONCAT(cpputilsTraceZone, __LINE__)(name)
+    #define CPPUTILS_TRACE_INSTANT(name) ::cpputils::traceEvent(::cpputils::TraceEventType::Instant, name, 0)
+    #define CPPUTILS_TRACE_COUNTER(name, value) ::cpputils::traceCounter(name, static_cast<double>(value))
+    #define CPPUTILS_TRACE_FLOW_BEGIN(name, id) ::cpputils::traceEvent(::cpputils::TraceEventType::FlowBegin, name, static_cast<u_int64_t>(id))
+    #define CPPUTILS_TRACE_FLOW_END(name, id) ::cpputils::traceEvent(::cpputils::TraceEventType::FlowEnd, name, static_cast<u_int64_t>(id))
+
+#else
+
+    #define CPPUTILS_TRACE_ZONE(name) ((void)0)
+    #define CPPUTILS_TRACE_INSTANT(name) ((void)0)
+    #define CPPUTILS_TRACE_COUNTER(name, value) ((void)0)
+    #define CPPUTILS_TRACE_FLOW_BEGIN(name, id) ((void)0)
+    #define CPPUTILS_TRACE_FLOW_END(name, id) ((void)0)
+
+#endif
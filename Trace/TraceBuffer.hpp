@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace cpputils {
+
+    enum class TraceEventType : u_int8_t {
+        Zone,
+        Instant,
+        Counter,
+        FlowBegin,
+        FlowEnd
+    };
+
+    // name is stored as a pointer and must outlive the trace; the macros
+    // only pass string literals
+    struct TraceEvent {
+        const char *name;
+        u_int64_t timestamp;
+        // End tick of a zone, bits of a counter's double value or a flow id
+        u_int64_t data;
+        TraceEventType type;
+    };
+
+    // Single-producer single-consumer ring written by one thread and drained
+    // by the flusher. A full ring drops the event rather than block the
+    // producer; dropped() counts the losses.
+    class TraceBuffer {
+    public:
+        static constexpr size_t capacity = 1 << 14;
+
+        TraceBuffer(u_int32_t thread)
+            : _thread(thread), _events(new TraceEvent[capacity])
+        {
+        }
+        TraceBuffer(const TraceBuffer &) = delete;
+        TraceBuffer &operator=(const TraceBuffer &) = delete;
+
+        u_int32_t thread() const
+        {
+            return _thread;
+        }
+
+        void push(const TraceEvent &event)
+        {
+            u_int64_t head = _head.load(std::memory_order_relaxed);
+            if (head - _cachedTail >= capacity) {
+                _cachedTail = _tail.load(std::memory_order_acquire);
+                if (head - _cachedTail >= capacity) {
+                    _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            _events[head & (capacity - 1)] = event;
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        // Consumer side: hands every pending event to sink, oldest first
+        template <typename F>
+        size_t drain(F &&sink)
+        {
+            u_int64_t tail = _tail.load(std::memory_order_relaxed);
+            u_int64_t head = _head.load(std::memory_order_acquire);
+            for (u_int64_t i = tail; i < head; i++)
+                sink(_events[i & (capacity - 1)]);
+            _tail.store(head, std::memory_order_release);
+            return static_cast<size_t>(head - tail);
+        }
+
+        u_int64_t dropped() const
+        {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+
+        // Set by the owning thread as it exits; nothing is pushed afterwards
+        void markExited()
+        {
+            _exited.store(true, std::memory_order_release);
+        }
+
+        bool exited() const
+        {
+            return _exited.load(std::memory_order_acquire);
+        }
+
+    private:
+        // Producer and consumer indices on separate cache lines
+        alignas(64) std::atomic<u_int64_t> _head{0};
+        u_int64_t _cachedTail = 0;
+        std::atomic<u_int64_t> _dropped{0};
+        alignas(64) std::atomic<u_int64_t> _tail{0};
+        std::atomic<bool> _exited{false};
+        u_int32_t _thread;
+        std::unique_ptr<TraceEvent[]> _events;
+    };
+
+} // namespace cpputils
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+#include "CpuFeatures.hpp"
+
+namespace cpputils {
+
+    // Raw timestamps for trace events. On x86 CPUs with an invariant TSC
+    // this is the TSC; elsewhere, and on CPUs whose TSC rate follows the
+    // core clock, it is steady_clock nanoseconds. Ticks become time only
+    // when a trace is written.
+    class TraceClock {
+    public:
+        static u_int64_t now()
+        {
+#ifdef CPPUTILS_X86
+            if (hasInvariantTsc())
+                return __rdtsc();
+#endif
+            return static_cast<u_int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Ticks per nanosecond, measured against steady_clock over window
+        static double ticksPerNanosecond(std::chrono::milliseconds window = std::chrono::milliseconds(10))
+        {
+            if (!hasInvariantTsc())
+                return 1.0;
+            auto steadyStart = std::chrono::steady_clock::now();
+            u_int64_t start = now();
+            std::this_thread::sleep_for(window);
+            auto steadyEnd = std::chrono::steady_clock::now();
+            u_int64_t end = now();
+            return static_cast<double>(end - start) / std::chrono::duration<double, std::nano>(steadyEnd - steadyStart).count();
+        }
+    };
+
+} // namespace cpputils
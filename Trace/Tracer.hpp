@@ -0,0 +1,386 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <charconv>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+#include <condition_variable>
+
+#include "JsonString.hpp"
+#include "TraceBuffer.hpp"
+#include "TraceClock.hpp"
+
+namespace cpputils {
+
+    namespace detail {
+
+        // Chrome trace-event JSON, viewable in chrome://tracing or Perfetto.
+        // Events are formatted into a string and written out by commit().
+        class ChromeTraceWriter {
+        public:
+            ChromeTraceWriter(std::ostream &os, double ticksPerNs, u_int64_t origin)
+                : _os(os), _ticksPerNs(ticksPerNs), _origin(origin)
+            {
+            }
+
+            void begin()
+            {
+                _out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            }
+
+            void write(const TraceEvent &event, u_int32_t thread)
+            {
+                _out += _first ? "\n{\"name\":" : ",\n{\"name\":";
+                _first = false;
+                appendJsonString(_out, event.name);
+                switch (event.type) {
+                case TraceEventType::Zone:
+                    _out += ",\"ph\":\"X\",\"ts\":";
+                    writeNumber(microseconds(event.timestamp));
+                    _out += ",\"dur\":";
+                    writeNumber(static_cast<double>(event.data > event.timestamp ? event.data - event.timestamp : 0) / _ticksPerNs / 1000);
+                    break;
+                case TraceEventType::Instant:
+                    _out += ",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+                    writeNumber(microseconds(event.timestamp));
+                    break;
+                case TraceEventType::Counter: {
+                    double value;
+                    std::memcpy(&value, &event.data, sizeof(value));
+                    _out += ",\"ph\":\"C\",\"ts\":";
+                    writeNumber(microseconds(event.timestamp));
+                    _out += ",\"args\":{\"value\":";
+                    writeNumber(std::isfinite(value) ? value : 0, false);
+                    _out += '}';
+                    break;
+                }
+                case TraceEventType::FlowBegin:
+                case TraceEventType::FlowEnd:
+                    _out += event.type == TraceEventType::FlowBegin ? ",\"cat\":\"flow\",\"ph\":\"s\",\"id\":"
+                        : ",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":";
+                    writeInteger(event.data);
+                    _out += ",\"ts\":";
+                    writeNumber(microseconds(event.timestamp));
+                    break;
+                }
+                _out += ",\"pid\":1,\"tid\":";
+                writeInteger(thread);
+                _out += '}';
+            }
+
+            void writeThreadName(u_int32_t thread, const std::string &name)
+            {
+                _out += _first ? "\n" : ",\n";
+                _first = false;
+                _out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+                writeInteger(thread);
+                _out += ",\"args\":{\"name\":";
+                appendJsonString(_out, name);
+                _out += "}}";
+            }
+
+            void finish()
+            {
+                _out += "\n]}\n";
+                commit();
+            }
+
+            void commit()
+            {
+                _os.write(_out.data(), static_cast<std::streamsize>(_out.size()));
+                _os.flush();
+                _out.clear();
+            }
+
+        private:
+            double microseconds(u_int64_t ticks) const
+            {
+                return (static_cast<double>(ticks) - static_cast<double>(_origin)) / _ticksPerNs / 1000;
+            }
+
+            // Timestamps and durations keep nanosecond precision
+            void writeNumber(double value, bool fixed = true)
+            {
+                char buffer[64];
+                std::to_chars_result result = fixed
+                    ? std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 3)
+                    : std::to_chars(buffer, buffer + sizeof(buffer), value);
+                _out.append(buffer, result.ec == std::errc() ? result.ptr : buffer);
+            }
+
+            void writeInteger(u_int64_t value)
+            {
+                char buffer[24];
+                _out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+            }
+
+            std::ostream &_os;
+            double _ticksPerNs;
+            u_int64_t _origin;
+            bool _first = true;
+            std::string _out;
+        };
+
+    } // namespace detail
+
+    // Owns the per-thread event buffers and the background thread that
+    // streams them to a trace file. Threads get a buffer on their first
+    // event; recording is a relaxed load, two clock reads and a ring write.
+    class Tracer {
+    public:
+        static Tracer &instance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        Tracer(const Tracer &) = delete;
+        Tracer &operator=(const Tracer &) = delete;
+        ~Tracer()
+        {
+            stop();
+        }
+
+        // Starts recording and writes Chrome trace-event JSON to path every
+        // flushInterval until stop()
+        void start(const std::string &path, std::chrono::milliseconds flushInterval = std::chrono::milliseconds(10))
+        {
+            std::lock_guard<std::mutex> control(_controlMutex);
+            if (_flusher.joinable())
+                throw std::runtime_error("Tracer is already running");
+            _file.open(path, std::ios::out | std::ios::trunc);
+            if (!_file)
+                throw std::runtime_error("Cannot open trace file: " + path);
+            double ticksPerNs = TraceClock::ticksPerNanosecond();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                // Leftovers of an earlier run belong to no file
+                for (const auto &buffer : _buffers)
+                    buffer->drain([](const TraceEvent &) {});
+                _droppedBase = droppedLocked();
+            }
+            {
+                std::lock_guard<std::mutex> lock(_flushMutex);
+                _writer = std::make_unique<detail::ChromeTraceWriter>(_file, ticksPerNs, TraceClock::now());
+                _writer->begin();
+                _stopping = false;
+            }
+            _enabled.store(true, std::memory_order_release);
+            _flusher = std::thread([this, flushInterval]() {
+                run(flushInterval);
+            });
+        }
+
+        // Writes what is left and closes the file; does nothing if not running
+        void stop()
+        {
+            std::lock_guard<std::mutex> control(_controlMutex);
+            if (!_flusher.joinable())
+                return;
+            _enabled.store(false, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(_flushMutex);
+                _stopping = true;
+            }
+            _wake.notify_one();
+            _flusher.join();
+            std::lock_guard<std::mutex> flushLock(_flushMutex);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (const auto &[thread, name] : _threadNames)
+                    _writer->writeThreadName(thread, name);
+            }
+            _writer->finish();
+            _writer.reset();
+            _file.close();
+        }
+
+        bool running() const
+        {
+            return enabled();
+        }
+
+        // Drains every buffer into the file now instead of at the next interval
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(_flushMutex);
+            if (_writer)
+                flushLocked();
+        }
+
+        // Events lost to full buffers since start()
+        u_int64_t dropped() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return droppedLocked() - _droppedBase;
+        }
+
+        // Labels the calling thread in traces written from now on
+        void setThreadName(const std::string &name)
+        {
+            TraceBuffer *buffer = threadBuffer();
+            if (!buffer)
+                return;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _threadNames[buffer->thread()] = name;
+        }
+
+        static bool enabled()
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        static void record(TraceEventType type, const char *name, u_int64_t timestamp, u_int64_t data)
+        {
+            TraceBuffer *buffer = _threadBuffer;
+            if (!buffer && !(buffer = instance().threadBuffer()))
+                return;
+            buffer->push(TraceEvent{name, timestamp, data, type});
+        }
+
+    private:
+        // Marks the thread's buffer as finished when the thread exits, so the
+        // flusher can drop it once drained
+        struct BufferOwner {
+            ~BufferOwner()
+            {
+                if (buffer)
+                    buffer->markExited();
+                _threadBuffer = nullptr;
+                _threadExited = true;
+            }
+
+            std::shared_ptr<TraceBuffer> buffer;
+        };
+
+        Tracer() = default;
+
+        // Returns nullptr while the calling thread is exiting
+        TraceBuffer *threadBuffer()
+        {
+            if (_threadBuffer || _threadExited)
+                return _threadBuffer;
+            thread_local BufferOwner owner;
+            std::lock_guard<std::mutex> lock(_mutex);
+            owner.buffer = std::make_shared<TraceBuffer>(++_threadCount);
+            _buffers.push_back(owner.buffer);
+            _threadBuffer = owner.buffer.get();
+            return _threadBuffer;
+        }
+
+        void run(std::chrono::milliseconds interval)
+        {
+            std::unique_lock<std::mutex> lock(_flushMutex);
+            while (!_stopping) {
+                _wake.wait_for(lock, interval, [this]() {
+                    return _stopping;
+                });
+                flushLocked();
+            }
+        }
+
+        // Called with _flushMutex held
+        void flushLocked()
+        {
+            std::vector<std::shared_ptr<TraceBuffer>> buffers;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                buffers = _buffers;
+            }
+            std::vector<TraceBuffer *> finished;
+            for (const auto &buffer : buffers) {
+                // An exited thread pushed its last event before the flag was set
+                bool exited = buffer->exited();
+                u_int32_t thread = buffer->thread();
+                buffer->drain([this, thread](const TraceEvent &event) {
+                    _writer->write(event, thread);
+                });
+                if (exited)
+                    finished.push_back(buffer.get());
+            }
+            _writer->commit();
+            if (finished.empty())
+                return;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _buffers.erase(std::remove_if(_buffers.begin(), _buffers.end(), [&](const std::shared_ptr<TraceBuffer> &buffer) {
+                if (std::find(finished.begin(), finished.end(), buffer.get()) == finished.end())
+                    return false;
+                _droppedRetired += buffer->dropped();
+                return true;
+            }), _buffers.end());
+        }
+
+        u_int64_t droppedLocked() const
+        {
+            u_int64_t total = _droppedRetired;
+            for (const auto &buffer : _buffers)
+                total += buffer->dropped();
+            return total;
+        }
+
+        inline static std::atomic<bool> _enabled{false};
+        inline static thread_local TraceBuffer *_threadBuffer = nullptr;
+        inline static thread_local bool _threadExited = false;
+
+        std::mutex _controlMutex;
+        mutable std::mutex _mutex;
+        std::vector<std::shared_ptr<TraceBuffer>> _buffers;
+        std::map<u_int32_t, std::string> _threadNames;
+        u_int32_t _threadCount = 0;
+        u_int64_t _droppedRetired = 0;
+        u_int64_t _droppedBase = 0;
+
+        std::mutex _flushMutex;
+        std::condition_variable _wake;
+        bool _stopping = false;
+        std::ofstream _file;
+        std::unique_ptr<detail::ChromeTraceWriter> _writer;
+        std::thread _flusher;
+    };
+
+    // Records the duration of its scope; what CPPUTILS_TRACE_ZONE expands to
+    class TraceZone {
+    public:
+        explicit TraceZone(const char *name)
+            : _name(name), _start(Tracer::enabled() ? TraceClock::now() : 0)
+        {
+        }
+        TraceZone(const TraceZone &) = delete;
+        TraceZone &operator=(const TraceZone &) = delete;
+        ~TraceZone()
+        {
+            if (_start && Tracer::enabled())
+                Tracer::record(TraceEventType::Zone, _name, _start, TraceClock::now());
+        }
+
+    private:
+        const char *_name;
+        u_int64_t _start;
+    };
+
+    inline void traceEvent(TraceEventType type, const char *name, u_int64_t data)
+    {
+        if (Tracer::enabled())
+            Tracer::record(type, name, TraceClock::now(), data);
+    }
+
+    inline void traceCounter(const char *name, double value)
+    {
+        u_int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        traceEvent(TraceEventType::Counter, name, bits);
+    }
+
+} // namespace cpputils